@@ -0,0 +1,69 @@
+// host benchmark: what each constellation choice costs the host, with the simulator
+// g++ -std=c++20 -O2 -Icallbackmanager -Iteseo -Isimulator benchmark/constellation_benchmark.cpp teseo/teseo.cpp -o constellation_benchmark && ./constellation_benchmark
+//
+// For each constellation choice, reports per GSV poll the sentence volume (lines and bytes) and the host cost
+// (request, simulated reply, validation and parse), and the Teseo CPU load that the simulator reports with $PSTMCPU.
+// The simulator answers instantly: times are the driver's host CPU cost, without bus time.
+// Time to first fix and power need the real module, and are not measured here.
+
+#include "teseo.h"
+#include "simulator.h"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr unsigned int polls = 100000;
+
+struct choice {
+    const char* name;
+    teseo::constellation constellations;
+};
+
+constexpr std::array<choice, 4> choices {{
+    {"GPS", teseo::constellation::gps},
+    {"GPS+GLONASS", teseo::constellation::gps | teseo::constellation::glonass},
+    {"GPS+Galileo", teseo::constellation::gps | teseo::constellation::galileo},
+    {"all", teseo::constellation::gps | teseo::constellation::glonass | teseo::constellation::qzss |
+        teseo::constellation::galileo | teseo::constellation::beidou}
+}};
+
+} // namespace
+
+int main() {
+    std::printf("%-12s %10s %10s %14s %10s\n", "choice", "lines", "bytes", "host ns/poll", "CPU %");
+    for (const choice& c : choices) {
+        teseo::simulator sim;
+        teseo::teseo gps;
+        gps.writer().set([&sim](const std::string& s) -> void { sim.write(s); });
+        gps.reader().set([&sim](std::string& s) -> void { sim.read(s); });
+        gps.resetter().set([&sim]() -> void { sim.reset(); });
+        gps.constellations(c.constellations);
+        gps.initialize();
+
+        float load = 0.0f;
+        gps.ask_cpu_load(load);
+
+        std::array<std::string, 16> gsv;
+        unsigned int count = 0;
+        unsigned long lines = 0;
+        unsigned long bytes = 0;
+        const clock_type::time_point start = clock_type::now();
+        for (unsigned int i = 0; i < polls; i++) {
+            if (gps.ask_gsv(gsv, count)) {
+                lines += count;
+                for (unsigned int l = 0; l < count; l++) {
+                    bytes += gsv[l].length();
+                }
+            }
+        }
+        const double ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / polls;
+        std::printf("%-12s %10.1f %10.1f %14.1f %10.1f\n", c.name, static_cast<double>(lines) / polls,
+            static_cast<double>(bytes) / polls, ns, load);
+    }
+    return 0;
+}
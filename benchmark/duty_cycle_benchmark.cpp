@@ -0,0 +1,103 @@
+// host benchmark: wake-to-fix time and on-time of the duty cycle controller, with the simulator's hot start model
+// g++ -std=c++20 -O2 -Icallbackmanager -Iteseo -Isimulator benchmark/duty_cycle_benchmark.cpp teseo/teseo.cpp teseo/duty_cycle.cpp -o duty_cycle_benchmark && ./duty_cycle_benchmark
+//
+// Usage: duty_cycle_benchmark [tick ms] [bit flip rate]
+// Defaults: 100 ms, 0.0
+//
+// Runs a simulated day per configuration, on a virtual clock that advances one tick per main loop pass.
+// The simulator reports no fix for hot start polls after each standby: the hot start takes that many ticks.
+// For each period, wake lead and hot start length, reports:
+// - fixes and misses (no fix within the 30 s fix timeout)
+// - wake-to-fix: mean and max time from the wake-up to the valid fix
+// - on-time: mean time awake per period, and the share of the day awake
+// - polls: GGA requests per period
+
+#include "teseo.h"
+#include "duty_cycle.h"
+#include "simulator.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+constexpr uint64_t day_ms = 24ull * 3600 * 1000;
+constexpr uint32_t fix_timeout_ms = 30000;
+constexpr std::array<uint32_t, 3> periods_ms {10000, 60000, 300000};
+constexpr std::array<uint32_t, 2> wake_leads_ms {1000, 2000};
+constexpr std::array<unsigned int, 4> hot_start_polls {0, 10, 40, 400};
+
+struct result {
+    unsigned long fixes;
+    unsigned long misses;
+    double mean_wake_to_fix_ms;
+    uint32_t max_wake_to_fix_ms;
+    double mean_on_time_ms;
+    double awake_percent;
+    double polls_per_period;
+};
+
+result run(uint32_t period_ms, uint32_t wake_lead_ms, unsigned int polls, uint32_t tick_ms, double bit_flip) {
+    teseo::simulator sim;
+    sim.faults().bit_flip = bit_flip;
+    sim.hot_start_requests() = polls;
+    unsigned long requests = 0;
+    teseo::teseo gps;
+    gps.writer().set([&sim, &requests](const std::string& s) -> void {
+        requests += s.starts_with("$PSTMNMEAREQUEST,");
+        sim.write(s);
+    });
+    gps.reader().set([&sim](std::string& s) -> void { sim.read(s); });
+    gps.resetter().set([&sim]() -> void { sim.reset(); });
+
+    teseo::duty_cycle cycle(gps, period_ms, wake_lead_ms, fix_timeout_ms);
+    std::string gga;
+    uint64_t wake_to_fix_ms = 0;
+    uint32_t max_wake_to_fix_ms = 0;
+    for (uint64_t now = 0; now < day_ms; now += tick_ms) {
+        if (cycle.tick(now, gga)) {
+            wake_to_fix_ms += cycle.statistics().wake_to_fix_ms;
+            max_wake_to_fix_ms = std::max(max_wake_to_fix_ms, cycle.statistics().wake_to_fix_ms);
+        }
+    }
+
+    const teseo::duty_cycle::report& r = cycle.statistics();
+    const unsigned long periods = r.fixes + r.misses;
+    return {
+        .fixes = r.fixes,
+        .misses = r.misses,
+        .mean_wake_to_fix_ms = r.fixes ? static_cast<double>(wake_to_fix_ms) / r.fixes : 0.0,
+        .max_wake_to_fix_ms = max_wake_to_fix_ms,
+        .mean_on_time_ms = periods ? static_cast<double>(r.total_on_time_ms) / periods : 0.0,
+        .awake_percent = 100.0 * r.total_on_time_ms / day_ms,
+        .polls_per_period = periods ? static_cast<double>(requests) / periods : 0.0,
+    };
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint32_t tick_ms = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 100;
+    const double bit_flip = argc > 2 ? std::strtod(argv[2], nullptr) : 0.0;
+    if (tick_ms == 0) {
+        std::fprintf(stderr, "tick ms must be > 0\n");
+        return 1;
+    }
+
+    std::printf("tick %u ms, bit flip %.4f, fix timeout %u ms, one day per row\n", tick_ms, bit_flip, fix_timeout_ms);
+    std::printf("%9s %8s %9s %7s %7s %12s %12s %11s %9s %7s\n", "period_s", "lead_ms", "hot_polls", "fixes",
+        "misses", "w2f_mean_ms", "w2f_max_ms", "on_mean_ms", "awake_%", "polls");
+    for (uint32_t period_ms : periods_ms) {
+        for (uint32_t wake_lead_ms : wake_leads_ms) {
+            for (unsigned int polls : hot_start_polls) {
+                result r = run(period_ms, wake_lead_ms, polls, tick_ms, bit_flip);
+                std::printf("%9u %8u %9u %7lu %7lu %12.0f %12u %11.0f %9.3f %7.1f\n", period_ms / 1000,
+                    wake_lead_ms, polls, r.fixes, r.misses, r.mean_wake_to_fix_ms, r.max_wake_to_fix_ms,
+                    r.mean_on_time_ms, r.awake_percent, r.polls_per_period);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+// host benchmark: robustness of the driver on a faulty link, with the simulator
+// g++ -std=c++20 -O2 -Icallbackmanager -Iteseo -Isimulator benchmark/fault_benchmark.cpp teseo/teseo.cpp -o fault_benchmark && ./fault_benchmark
+//
+// For each fault kind and rate, reports per API:
+// - valid: share of calls with a valid reply
+// - goodput: validated payload bytes per second of host time
+// - recovery: mean host time from a failed call until the next valid reply, with resync() after each failure
+// The simulator answers instantly: times are the driver's host CPU cost, without bus time.
+
+#include "teseo.h"
+#include "simulator.h"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr unsigned int calls = 20000;
+constexpr std::array<double, 4> rates {0.0, 0.01, 0.05, 0.2};
+
+struct result {
+    double valid_percent;
+    double goodput_bytes_s;
+    double recovery_us;
+};
+
+enum class fault { bit_flip, truncate, interleave, stall, ff_flood, missing_status };
+
+const char* name(fault f) {
+    switch (f) {
+    case fault::bit_flip: return "bit_flip";
+    case fault::truncate: return "truncate";
+    case fault::interleave: return "interleave";
+    case fault::stall: return "stall";
+    case fault::ff_flood: return "ff_flood";
+    case fault::missing_status: return "missing_status";
+    }
+    return "";
+}
+
+void configure(teseo::simulator& sim, fault f, double rate) {
+    sim.faults() = teseo::simulator::fault_rates();
+    switch (f) {
+    case fault::bit_flip: sim.faults().bit_flip = rate; break;
+    case fault::truncate: sim.faults().truncate = rate; break;
+    case fault::interleave: sim.faults().interleave = rate; break;
+    case fault::stall: sim.faults().stall = rate; break;
+    case fault::ff_flood: sim.faults().ff_flood = rate; break;
+    case fault::missing_status: sim.faults().missing_status = rate; break;
+    }
+}
+
+void connect(teseo::teseo& gps, teseo::simulator& sim) {
+    gps.writer().set([&sim](const std::string& s) -> void { sim.write(s); });
+    gps.reader().set([&sim](std::string& s) -> void { sim.read(s); });
+    gps.resetter().set([&sim]() -> void { sim.reset(); });
+}
+
+// ask() returns the validated payload bytes, 0 if invalid
+template <typename F>
+result run(teseo::teseo& gps, F&& ask) {
+    unsigned long valid = 0;
+    unsigned long bytes = 0;
+    unsigned long recoveries = 0;
+    clock_type::duration recovering {};
+    const clock_type::time_point start = clock_type::now();
+    for (unsigned int i = 0; i < calls; i++) {
+        std::size_t payload = ask();
+        if (payload) {
+            valid++;
+            bytes += payload;
+            continue;
+        }
+        // failed: recover, and time it until a call is valid again
+        const clock_type::time_point failed = clock_type::now();
+        while (!(gps.resync() && ask())) {
+        }
+        recovering += clock_type::now() - failed;
+        recoveries++;
+    }
+    const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+    return {100.0 * valid / calls, bytes / seconds,
+        recoveries ? std::chrono::duration<double, std::micro>(recovering).count() / recoveries : 0.0};
+}
+
+} // namespace
+
+int main() {
+    std::printf("%-15s %6s | %-28s | %-28s | %s\n", "fault", "rate", "ask_nmea (GGA)", "ask_nmea_multiple (GSV)", "initialize()");
+    std::printf("%-15s %6s | %8s %10s %8s | %8s %10s %8s | %8s %10s\n", "", "", "valid %", "bytes/s", "rec. us",
+        "valid %", "bytes/s", "rec. us", "valid %", "us");
+    for (fault f : {fault::bit_flip, fault::truncate, fault::interleave, fault::stall, fault::ff_flood, fault::missing_status}) {
+        for (double rate : rates) {
+            teseo::simulator sim;
+            teseo::teseo gps;
+            connect(gps, sim);
+            configure(sim, f, rate);
+
+            std::string gga;
+            result single = run(gps, [&gps, &gga]() -> std::size_t { return gps.ask_gga(gga) ? gga.length() : 0; });
+
+            std::array<std::string, 8> gsv;
+            unsigned int count;
+            result multiple = run(gps, [&gps, &gsv, &count]() -> std::size_t {
+                if (!gps.ask_gsv(gsv, count)) {
+                    return 0;
+                }
+                std::size_t bytes = 0;
+                for (unsigned int i = 0; i < count; i++) {
+                    bytes += gsv[i].length();
+                }
+                return bytes;
+            });
+
+            // initialize(), judged by a probe right after it. No resync: this is the cold start path
+            unsigned long probes = 0;
+            const clock_type::time_point start = clock_type::now();
+            for (unsigned int i = 0; i < calls / 10; i++) {
+                gps.initialize();
+                probes += gps.ask_gll(gga);
+            }
+            const double init_us = std::chrono::duration<double, std::micro>(clock_type::now() - start).count() / (calls / 10);
+
+            std::printf("%-15s %6.2f | %8.2f %10.0f %8.2f | %8.2f %10.0f %8.2f | %8.2f %10.2f\n", name(f), rate,
+                single.valid_percent, single.goodput_bytes_s, single.recovery_us,
+                multiple.valid_percent, multiple.goodput_bytes_s, multiple.recovery_us,
+                100.0 * probes / (calls / 10), init_us);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+// host benchmark: how many simulated receivers and clients one host core serves, with the simulator and relay
+// g++ -std=c++20 -O2 -Icallbackmanager -Iteseo -Isimulator -Irelay benchmark/fleet_benchmark.cpp teseo/teseo.cpp -o fleet_benchmark && ./fleet_benchmark
+//
+// Each receiver is a simulator and its own teseo object, over an in-memory link. Per epoch (a 1 Hz fix), it is
+// polled for GGA, RMC and GSV, and the replies are pushed into its relay, that fans them out to 4 clients with their
+// own filters: everything, position only (GGA, RMC), GGA with a fix, and satellites (GSV). The clients are in-memory
+// sinks that take all bytes.
+// For each fleet size, reports:
+// - CPU per receiver: process CPU time per receiver and epoch, and the receivers that one core serves at 1 Hz
+// - fix latency: from the GGA poll to the last client write of that receiver, percentiles over all receivers and epochs
+// - memory per receiver: heap in use (glibc mallinfo2) after the fleet's first epoch, divided by its size. Without
+//   glibc, the resident memory growth (Linux /proc/self/statm), that undercounts when an earlier fleet's memory is reused
+// The receivers run one after the other, on one thread. The simulator answers instantly: without bus time, the
+// numbers are the host's share of the work.
+
+#include "teseo.h"
+#include "simulator.h"
+#include "relay.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::array<std::size_t, 4> fleet_sizes {100, 500, 2000, 5000};
+constexpr unsigned int epochs = 20;
+
+constexpr std::array<std::string_view, 2> position {"GGA", "RMC"};
+constexpr std::array<std::string_view, 1> gga {"GGA"};
+constexpr std::array<std::string_view, 1> satellites {"GSV"};
+
+//! a simulated receiver with its driver, relay and clients
+struct receiver {
+    teseo::simulator sim;
+    teseo::teseo gps;
+    teseo::relay<> relay;
+    std::array<unsigned long, 4> client_bytes {};
+    std::string line;
+    std::array<std::string, 8> lines;
+
+    receiver(unsigned int seed) : sim(seed) {
+        gps.writer().set([this](const std::string& s) -> void { sim.write(s); });
+        gps.reader().set([this](std::string& s) -> void { sim.read(s); });
+        relay.filter(1, {.sentences = position});
+        relay.filter(2, {.sentences = gga, .min_quality = 1});
+        relay.filter(3, {.sentences = satellites});
+        for (std::size_t i = 0; i < client_bytes.size(); i++) {
+            relay.output(i).set([this, i](std::span<const std::string_view> pieces) -> std::size_t {
+                std::size_t bytes = 0;
+                for (auto piece : pieces) {
+                    bytes += piece.size();
+                }
+                client_bytes[i] += bytes;
+                return bytes;
+            });
+        }
+    }
+
+    //! one epoch: poll, fan out
+    void epoch() {
+        if (gps.ask_gga(line)) {
+            relay.push(line);
+        }
+        if (gps.ask_rmc(line)) {
+            relay.push(line);
+        }
+        unsigned int count;
+        if (gps.ask_gsv(lines, count)) {
+            for (unsigned int i = 0; i < count; i++) {
+                relay.push(lines[i]);
+            }
+        }
+        relay.pump_all();
+    }
+};
+
+//! memory in use, KiB: the heap with glibc, else the resident memory. 0 if unknown
+unsigned long memory_kib() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks / 1024;
+#else
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    if (std::FILE* f = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(f, "%lu %lu", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(f);
+    }
+    return resident * 4; // 4 KiB pages
+#endif
+}
+
+double cpu_seconds() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+//! latency percentile, ns. Reorders the samples
+uint32_t percentile(std::vector<uint32_t>& samples, double p) {
+    auto nth = samples.begin() + static_cast<std::ptrdiff_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+
+} // namespace
+
+int main() {
+    std::printf("%9s | %12s %14s | %8s %8s %8s %8s | %12s | %s\n", "receivers", "CPU us/epoch", "receivers/core",
+        "p50 ns", "p99 ns", "p99.9 ns", "max ns", "KiB/receiver", "client KiB/s");
+    for (std::size_t size : fleet_sizes) {
+        const unsigned long memory_before = memory_kib();
+        std::vector<std::unique_ptr<receiver>> fleet;
+        fleet.reserve(size);
+        for (std::size_t i = 0; i < size; i++) {
+            fleet.push_back(std::make_unique<receiver>(static_cast<unsigned int>(i + 1)));
+        }
+        for (auto& r : fleet) { // warm-up: buffers grow to their steady size
+            r->epoch();
+        }
+        const unsigned long memory_after = memory_kib();
+
+        std::vector<uint32_t> latency;
+        latency.reserve(size * epochs);
+        const double cpu_start = cpu_seconds();
+        const clock_type::time_point wall_start = clock_type::now();
+        for (unsigned int epoch = 0; epoch < epochs; epoch++) {
+            for (auto& r : fleet) {
+                const clock_type::time_point start = clock_type::now();
+                r->epoch();
+                latency.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count()));
+            }
+        }
+        const double cpu_us = (cpu_seconds() - cpu_start) * 1e6 / (static_cast<double>(size) * epochs);
+        const double wall_s = std::chrono::duration<double>(clock_type::now() - wall_start).count();
+        unsigned long client_bytes = 0;
+        for (auto& r : fleet) {
+            for (unsigned long bytes : r->client_bytes) {
+                client_bytes += bytes;
+            }
+        }
+
+        const uint32_t p50 = percentile(latency, 0.5);
+        const uint32_t p99 = percentile(latency, 0.99);
+        const uint32_t p999 = percentile(latency, 0.999);
+        const uint32_t max = *std::max_element(latency.begin(), latency.end());
+        std::printf("%9zu | %12.2f %14.0f | %8u %8u %8u %8u | %12.2f | %.0f\n", size, cpu_us, cpu_us > 0.0 ? 1e6 / cpu_us : 0.0,
+            p50, p99, p999, max, static_cast<double>(memory_after - std::min(memory_after, memory_before)) / size,
+            client_bytes / 1024.0 / wall_s);
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+// host benchmark: long running soak of all ask_*() methods, with the simulator. Fails on memory growth or latency drift
+// g++ -std=c++20 -O2 -Icallbackmanager -Iteseo -Isimulator benchmark/soak_benchmark.cpp teseo/teseo.cpp -o soak_benchmark && ./soak_benchmark
+//
+// Usage: soak_benchmark [cycles] [max RSS growth KiB] [max allocations per cycle] [max p99 growth factor] [bit flip rate]
+// Defaults: 1000000 cycles, 256 KiB, 0.01, 3.0, 0.001
+//
+// A cycle calls every ask_*() method once. A failed call is followed by resync(), so that the failure paths soak too.
+// A resync() that escalates to the restart writes its commands as temporary strings: at high bit flip rates, raise
+// the allocation limit.
+// Every interval of cycles/10 cycles reports the resident memory (Linux /proc/self/statm), the heap allocations
+// (counted by replacing operator new), the heap in use (glibc mallinfo2, when available) and the latency
+// percentiles of a call. The first interval is the warm-up: buffers grow to their steady size there.
+// The soak fails (exit code 1) when, after the warm-up:
+// - the resident memory grew more than the limit
+// - the allocations per cycle exceed the limit
+// - the p99 latency of an interval exceeds the warm-up p99 times the factor (1 µs floor, for timer resolution)
+// The simulator answers instantly: times are the driver's host CPU cost, without bus time.
+
+#include "teseo.h"
+#include "simulator.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<unsigned long> allocations {0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr unsigned int intervals = 10;
+constexpr unsigned int calls_per_cycle = 8;
+
+//! resident memory, KiB. 0 if unknown
+unsigned long resident_kib() {
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    if (std::FILE* f = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(f, "%lu %lu", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(f);
+    }
+    return resident * 4; // 4 KiB pages
+}
+
+//! heap in use, KiB. 0 if unknown
+unsigned long heap_kib() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks / 1024;
+#else
+    return 0;
+#endif
+}
+
+//! latency percentile, ns. Reorders the samples
+uint32_t percentile(std::vector<uint32_t>& samples, double p) {
+    auto nth = samples.begin() + static_cast<std::ptrdiff_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), nth, samples.end());
+    return *nth;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const unsigned long cycles = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const unsigned long max_rss_growth_kib = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+    const double max_allocations_per_cycle = argc > 3 ? std::strtod(argv[3], nullptr) : 0.01;
+    const double max_p99_factor = argc > 4 ? std::strtod(argv[4], nullptr) : 3.0;
+    const double bit_flip = argc > 5 ? std::strtod(argv[5], nullptr) : 0.001;
+    const unsigned long per_interval = std::max(cycles / intervals, 1ul);
+
+    teseo::simulator sim;
+    sim.faults().bit_flip = bit_flip;
+    teseo::teseo gps;
+    gps.writer().set([&sim](const std::string& s) -> void { sim.write(s); });
+    gps.reader().set([&sim](std::string& s) -> void { sim.read(s); });
+    gps.resetter().set([&sim]() -> void { sim.reset(); });
+
+    std::string line;
+    std::array<std::string, 8> lines;
+    unsigned int count;
+    float load;
+    teseo::packed_reply packed;
+    // reserved up front, so that the samples don't count as driver allocations
+    std::vector<uint32_t> latency;
+    latency.reserve(per_interval * calls_per_cycle);
+
+    auto timed = [&gps, &latency](auto&& ask) -> void {
+        const clock_type::time_point start = clock_type::now();
+        const bool valid = ask();
+        latency.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count()));
+        if (!valid) {
+            gps.resync();
+        }
+    };
+
+    std::printf("%8s %10s %10s %10s %12s %8s %8s %8s %8s %8s\n", "interval", "cycles", "RSS KiB", "heap KiB",
+        "allocs/cyc", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "invalid");
+    bool pass = true;
+    unsigned long baseline_rss = 0;
+    uint32_t baseline_p99 = 0;
+    unsigned long invalid_before = 0;
+    for (unsigned int interval = 0; interval < intervals; interval++) {
+        latency.clear();
+        const unsigned long allocations_before = allocations.load();
+        for (unsigned long cycle = 0; cycle < per_interval; cycle++) {
+            timed([&]() { return gps.ask_gga(line); });
+            timed([&]() { return gps.ask_gll(line); });
+            timed([&]() { return gps.ask_rmc(line); });
+            timed([&]() { return gps.ask_vtg(line); });
+            timed([&]() { return gps.ask_gsv(lines, count); });
+            timed([&]() { return gps.ask_gsa(lines, count); });
+            timed([&]() { return gps.ask<teseo::sentence::gsv>(packed); });
+            timed([&]() { return gps.ask_cpu_load(load); });
+        }
+        const double allocations_per_cycle = static_cast<double>(allocations.load() - allocations_before) / per_interval;
+        const unsigned long rss = resident_kib();
+        const unsigned long invalid = gps.statistics().invalid_replies - invalid_before;
+        invalid_before = gps.statistics().invalid_replies;
+        const uint32_t p50 = percentile(latency, 0.5);
+        const uint32_t p99 = percentile(latency, 0.99);
+        const uint32_t p999 = percentile(latency, 0.999);
+        const uint32_t max = *std::max_element(latency.begin(), latency.end());
+        std::printf("%8u %10lu %10lu %10lu %12.4f %8u %8u %8u %8u %8lu\n", interval, (interval + 1) * per_interval, rss,
+            heap_kib(), allocations_per_cycle, p50, p99, p999, max, invalid);
+
+        if (interval == 0) { // warm-up
+            baseline_rss = rss;
+            baseline_p99 = std::max(p99, 1000u);
+            continue;
+        }
+        if (rss > baseline_rss + max_rss_growth_kib) {
+            std::printf("FAIL: resident memory grew %lu KiB, limit %lu KiB\n", rss - baseline_rss, max_rss_growth_kib);
+            pass = false;
+        }
+        if (allocations_per_cycle > max_allocations_per_cycle) {
+            std::printf("FAIL: %.4f allocations per cycle, limit %.4f\n", allocations_per_cycle, max_allocations_per_cycle);
+            pass = false;
+        }
+        if (p99 > baseline_p99 * max_p99_factor) {
+            std::printf("FAIL: p99 %u ns, limit %.0f ns\n", p99, baseline_p99 * max_p99_factor);
+            pass = false;
+        }
+    }
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
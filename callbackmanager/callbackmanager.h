@@ -9,6 +9,9 @@
 #define CALLBACKMANAGER_H_
 
 #include <functional>
+#include <atomic>
+#include <array>
+#include <thread>
 
 template <typename R, typename... Args>
 // restrict to arithmetic data types for return value, or void
@@ -18,43 +21,100 @@ template <typename R, typename... Args>
 #endif
 #endif
 
+/*
+ * Callback is not copyable or movable: calls in progress refer to its slots and counters.
+ * Classes that hold one (e.g.: teseo::teseo) are not copyable or movable either.
+ * Construct them in place, and pass them by reference.
+ */
 class Callback {
 public:
-	Callback() : callback_(nullptr){}
+	Callback() : slots_(), active_(0), in_flight_{0, 0} {}
 
+	Callback(const Callback&) = delete;
+	Callback& operator=(const Callback&) = delete;
+
+	/*
+	 * The handler can be replaced while other threads call it.
+	 * The new handler is stored in the inactive slot, then published with a single atomic store.
+	 * Calls in progress finish on the old handler. The old slot is only reused by the next set(),
+	 * after its last call returned: set() waits (yielding the CPU) for calls that still run on that slot.
+	 * A handler that blocks, delays the second set() after it started, until it returns.
+	 * A handler may replace its own Callback once. Doing it twice in the same call never returns.
+	 * set() and unset() must not be called from more than one thread at the same time.
+	 */
 	inline void set(std::function<R(Args... args)> callback) {
-	    callback_ = & callback;
+		publish(std::move(callback));
 	}
 
 	inline void unset() {
-	    callback_ = nullptr;
+		publish(nullptr);
 	}
 
 	/*
 	 * R can either be an arithmetic type, or void
 	 */
 	inline R call(Args... args) {
+		pinned guard(*this); // unpins when the handler returns or throws
 		if constexpr (std::is_void<R>::value) {
-			if (callback_ == nullptr) {
-				return;
+			if (slots_[guard.slot]) {
+				slots_[guard.slot](args...);
 			}
-			(*callback_)(args...);
 		}
 
 		if constexpr (! std::is_void<R>::value) {
-			if (callback_ == nullptr) {
-				return 0; // R can only be a arithmetic type. 0 should work as default.
+			R retval = 0; // R can only be a arithmetic type. 0 should work as default.
+			if (slots_[guard.slot]) {
+				retval = slots_[guard.slot](args...);
 			}
-			return (*callback_)(args...);
+			return retval;
 		}
 	}
 
 	inline bool is_set() {
-		return (callback_ != nullptr);		
+		pinned guard(*this);
+		return static_cast<bool>(slots_[guard.slot]);
 	}
 
 private:
-	std::function<R(Args... args)> *callback_;
+	// holds a pin on the active slot for its lifetime
+	struct pinned {
+		pinned(Callback& c) : callback(c), slot(c.pin()) {}
+		~pinned() {
+			callback.unpin(slot);
+		}
+		Callback& callback;
+		const unsigned int slot;
+	};
+
+	// register a call on the active slot. Retry if a set() published the other slot in between.
+	inline unsigned int pin() {
+		unsigned int slot = active_.load();
+		in_flight_[slot].fetch_add(1);
+		while (active_.load() != slot) {
+			in_flight_[slot].fetch_sub(1);
+			slot = active_.load();
+			in_flight_[slot].fetch_add(1);
+		}
+		return slot;
+	}
+
+	inline void unpin(unsigned int slot) {
+		in_flight_[slot].fetch_sub(1);
+	}
+
+	inline void publish(std::function<R(Args... args)> callback) {
+		unsigned int slot = active_.load() ^ 1;
+		// calls that started before the previous set() may still run on this slot
+		while (in_flight_[slot].load() != 0) {
+			std::this_thread::yield();
+		}
+		slots_[slot] = std::move(callback);
+		active_.store(slot);
+	}
+
+	std::array<std::function<R(Args... args)>, 2> slots_;
+	std::atomic<unsigned int> active_;
+	std::array<std::atomic<unsigned int>, 2> in_flight_;
 };
 
 
@@ -0,0 +1,186 @@
+#include "distance.h"
+#include "wgs84.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+#include <algorithm>
+#include <cmath>
+
+namespace teseo {
+
+namespace geodesy {
+
+namespace {
+
+using wgs84::a;
+using wgs84::f;
+using wgs84::b;
+//! mean radius, (2a + b) / 3
+constexpr double radius = 6371008.8;
+
+constexpr unsigned int max_iterations = 200;
+//! change of lambda at which the iteration stops, rad. ~0.06 mm
+constexpr double converged = 1e-12;
+
+inline double haversine_of(double latitude1, double longitude1, double latitude2, double longitude2) {
+    const double phi1 = latitude1 * degree;
+    const double phi2 = latitude2 * degree;
+    const double sin_dphi = std::sin((phi2 - phi1) * 0.5);
+    const double sin_dlambda = std::sin((longitude2 - longitude1) * degree * 0.5);
+    const double h = sin_dphi * sin_dphi + std::cos(phi1) * std::cos(phi2) * sin_dlambda * sin_dlambda;
+    return 2.0 * radius * std::asin(std::sqrt(std::min(h, 1.0)));
+}
+
+inline double bearing_of(double latitude1, double longitude1, double latitude2, double longitude2) {
+    const double phi1 = latitude1 * degree;
+    const double phi2 = latitude2 * degree;
+    const double dlambda = (longitude2 - longitude1) * degree;
+    const double y = std::sin(dlambda) * std::cos(phi2);
+    const double x = std::cos(phi1) * std::sin(phi2) - std::sin(phi1) * std::cos(phi2) * std::cos(dlambda);
+    const double degrees = std::atan2(y, x) / degree;
+    return degrees < 0.0 ? degrees + 360.0 : degrees;
+}
+
+//! steps between consecutive points that the batch can handle: the shorter column and the output limit it
+inline std::size_t steps(std::span<const double> latitude, std::span<const double> longitude, std::span<double> out) {
+    const std::size_t points = std::min(latitude.size(), longitude.size());
+    return points < 2 ? 0 : std::min(points - 1, out.size());
+}
+
+//! compensated addition: sum + compensation holds the exact total
+inline void accumulate(double& sum, double& compensation, double x) {
+    const double t = sum + x;
+    if (std::fabs(sum) >= std::fabs(x)) {
+        compensation += (sum - t) + x;
+    } else {
+        compensation += (x - t) + sum;
+    }
+    sum = t;
+}
+
+} // namespace
+
+double haversine(double latitude1, double longitude1, double latitude2, double longitude2) {
+    return haversine_of(latitude1, longitude1, latitude2, longitude2);
+}
+
+double bearing(double latitude1, double longitude1, double latitude2, double longitude2) {
+    return bearing_of(latitude1, longitude1, latitude2, longitude2);
+}
+
+bool vincenty(double latitude1, double longitude1, double latitude2, double longitude2, double& distance, double& bearing) {
+    const double L = (longitude2 - longitude1) * degree;
+    const double U1 = std::atan((1.0 - f) * std::tan(latitude1 * degree)); // reduced latitudes
+    const double U2 = std::atan((1.0 - f) * std::tan(latitude2 * degree));
+    const double sin_U1 = std::sin(U1), cos_U1 = std::cos(U1);
+    const double sin_U2 = std::sin(U2), cos_U2 = std::cos(U2);
+
+    double lambda = L;
+    double sin_sigma, cos_sigma, sigma, cos2_alpha, cos_2sigma_m, sin_lambda, cos_lambda;
+    unsigned int iteration = 0;
+    while (true) {
+        sin_lambda = std::sin(lambda);
+        cos_lambda = std::cos(lambda);
+        const double p = cos_U2 * sin_lambda;
+        const double q = cos_U1 * sin_U2 - sin_U1 * cos_U2 * cos_lambda;
+        sin_sigma = std::sqrt(p * p + q * q);
+        if (sin_sigma == 0.0) { // same point
+            distance = 0.0;
+            bearing = 0.0;
+            return true;
+        }
+        cos_sigma = sin_U1 * sin_U2 + cos_U1 * cos_U2 * cos_lambda;
+        sigma = std::atan2(sin_sigma, cos_sigma);
+        const double sin_alpha = cos_U1 * cos_U2 * sin_lambda / sin_sigma;
+        cos2_alpha = 1.0 - sin_alpha * sin_alpha;
+        cos_2sigma_m = cos2_alpha != 0.0 ? cos_sigma - 2.0 * sin_U1 * sin_U2 / cos2_alpha : 0.0; // 0 on the equator
+        const double C = f / 16.0 * cos2_alpha * (4.0 + f * (4.0 - 3.0 * cos2_alpha));
+        const double previous = lambda;
+        lambda = L + (1.0 - C) * f * sin_alpha *
+            (sigma + C * sin_sigma * (cos_2sigma_m + C * cos_sigma * (-1.0 + 2.0 * cos_2sigma_m * cos_2sigma_m)));
+        if (std::fabs(lambda - previous) < converged) {
+            break;
+        }
+        if (++iteration == max_iterations) {
+            return false;
+        }
+    }
+
+    const double u2 = cos2_alpha * (a * a - b * b) / (b * b);
+    const double A = 1.0 + u2 / 16384.0 * (4096.0 + u2 * (-768.0 + u2 * (320.0 - 175.0 * u2)));
+    const double B = u2 / 1024.0 * (256.0 + u2 * (-128.0 + u2 * (74.0 - 47.0 * u2)));
+    const double delta_sigma = B * sin_sigma * (cos_2sigma_m + B / 4.0 * (cos_sigma * (-1.0 + 2.0 * cos_2sigma_m * cos_2sigma_m) -
+        B / 6.0 * cos_2sigma_m * (-3.0 + 4.0 * sin_sigma * sin_sigma) * (-3.0 + 4.0 * cos_2sigma_m * cos_2sigma_m)));
+    distance = b * A * (sigma - delta_sigma);
+    const double degrees = std::atan2(cos_U2 * sin_lambda, cos_U1 * sin_U2 - sin_U1 * cos_U2 * cos_lambda) / degree;
+    bearing = degrees < 0.0 ? degrees + 360.0 : degrees;
+    return true;
+}
+
+std::size_t haversine(std::span<const double> latitude, std::span<const double> longitude, std::span<double> out) {
+    TESEO_TRACE_SCOPE("geodesy: haversine");
+    const std::size_t count = steps(latitude, longitude, out);
+    for (std::size_t i = 0; i < count; i++) {
+        out[i] = haversine_of(latitude[i], longitude[i], latitude[i + 1], longitude[i + 1]);
+    }
+    return count;
+}
+
+std::size_t bearing(std::span<const double> latitude, std::span<const double> longitude, std::span<double> out) {
+    TESEO_TRACE_SCOPE("geodesy: bearing");
+    const std::size_t count = steps(latitude, longitude, out);
+    for (std::size_t i = 0; i < count; i++) {
+        out[i] = bearing_of(latitude[i], longitude[i], latitude[i + 1], longitude[i + 1]);
+    }
+    return count;
+}
+
+double track_length(std::span<const double> latitude, std::span<const double> longitude) {
+    double sum = 0.0;
+    double compensation = 0.0;
+    const std::size_t points = std::min(latitude.size(), longitude.size());
+    for (std::size_t i = 1; i < points; i++) {
+        accumulate(sum, compensation, haversine_of(latitude[i - 1], longitude[i - 1], latitude[i], longitude[i]));
+    }
+    return sum + compensation;
+}
+
+double odometer::add(double latitude, double longitude) {
+    if (!started_) {
+        started_ = true;
+        latitude_ = latitude;
+        longitude_ = longitude;
+        return 0.0;
+    }
+    const double step = haversine_of(latitude_, longitude_, latitude, longitude);
+    if (step < min_step_m_) {
+        return 0.0;
+    }
+    accumulate(total_, compensation_, step);
+    latitude_ = latitude;
+    longitude_ = longitude;
+    steps_++;
+    return step;
+}
+
+double odometer::add(const nmea::gga& fix) {
+    return fix.quality ? add(fix.latitude, fix.longitude) : 0.0;
+}
+
+double odometer::add(const nmea::rmc& fix) {
+    return fix.valid ? add(fix.latitude, fix.longitude) : 0.0;
+}
+
+void odometer::reset() {
+    total_ = 0.0;
+    compensation_ = 0.0;
+    started_ = false;
+    steps_ = 0;
+}
+
+} // namespace geodesy
+
+} // namespace teseo
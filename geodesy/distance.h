@@ -0,0 +1,110 @@
+#ifndef DISTANCE_H_
+#define DISTANCE_H_
+
+#include <span>
+#include "nmea.h"
+
+namespace teseo {
+
+namespace geodesy {
+
+//! great circle distance, with the haversine formula on a sphere of mean earth radius
+/*!
+  \param latitude1 double degrees, start.
+  \param longitude1 double degrees.
+  \param latitude2 double degrees, end.
+  \param longitude2 double degrees.
+  \returns double distance, m. Within 0.6 % of the ellipsoidal distance: the worst case is north-south, near the equator
+*/
+double haversine(double latitude1, double longitude1, double latitude2, double longitude2);
+
+//! initial bearing of the great circle from point 1 to point 2
+/*!
+  \returns double degrees true, 0 - 360
+*/
+double bearing(double latitude1, double longitude1, double latitude2, double longitude2);
+
+//! distance and initial bearing on the WGS84 ellipsoid, with Vincenty's inverse formula
+/*!
+  \param distance double reference gets the distance, m. Sub mm accuracy.
+  \param bearing double reference gets the initial bearing, degrees true.
+  \returns bool false if the iteration didn't converge: nearly antipodal points. Use haversine() then
+*/
+bool vincenty(double latitude1, double longitude1, double latitude2, double longitude2, double& distance, double& bearing);
+
+//! distances between consecutive points of a track, with haversine()
+/*!
+  \param latitude std::span<const double> degrees.
+  \param longitude std::span<const double> degrees.
+  \param out std::span<double> gets latitude.size() - 1 distances, m. out[i]: from point i to point i + 1.
+  \returns std::size_t number of distances written. The shorter column and the size of out limit it.
+
+  A branch free loop over the columns, without allocation. GCC vectorises it at -O3 -ffast-math, with sin, cos and
+  asin from glibc's vector math library (libmvec). The bearing() loop calls atan2, and stays scalar.
+*/
+std::size_t haversine(std::span<const double> latitude, std::span<const double> longitude, std::span<double> out);
+
+//! bearings between consecutive points of a track. See haversine(std::span<const double>, std::span<const double>, std::span<double>)
+std::size_t bearing(std::span<const double> latitude, std::span<const double> longitude, std::span<double> out);
+
+//! length of a track, m. Haversine distances, added up without float drift. Up to the end of the shorter column
+double track_length(std::span<const double> latitude, std::span<const double> longitude);
+
+//! Host side odometer, for when the Teseo odometer isn't used.
+/*!
+  Add each live fix. Fixes without quality are ignored. A fix that is less than min_step_m from the last counted one
+  is not counted: that suppresses the drift of the position while standing still.
+  The total is kept with compensated (Kahan-Babuska) summation: after months of 1 s steps, it has no rounding drift.
+*/
+class odometer {
+public:
+
+    //! constructor.
+    /*!
+      \param min_step_m double jitter threshold, m. 0: count every fix.
+    */
+    odometer(double min_step_m = 0.0) : min_step_m_(min_step_m), total_(0.0), compensation_(0.0),
+        latitude_(0.0), longitude_(0.0), started_(false), steps_(0) {}
+
+    //! add a position
+    /*!
+      \returns double the distance that was counted, m
+    */
+    double add(double latitude, double longitude);
+
+    //! add a GGA fix. Ignored without fix quality
+    double add(const nmea::gga& fix);
+
+    //! add a RMC fix. Ignored without status A
+    double add(const nmea::rmc& fix);
+
+    //! distance since the start or reset(), m
+    inline double total() const {
+        return total_ + compensation_;
+    }
+
+    //! number of counted steps
+    inline unsigned long steps() const {
+        return steps_;
+    }
+
+    //! start from 0. The next fix is the new starting point
+    void reset();
+
+private:
+    double min_step_m_;
+    double total_;
+    //! low order bits that total_ can't hold
+    double compensation_;
+    //! last counted position
+    double latitude_;
+    double longitude_;
+    bool started_;
+    unsigned long steps_;
+};
+
+} // namespace geodesy
+
+} // namespace teseo
+
+#endif // DISTANCE_H_
@@ -0,0 +1,228 @@
+#include "geodesy.h"
+#include "wgs84.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace teseo {
+
+namespace geodesy {
+
+namespace {
+
+using wgs84::a;
+using wgs84::f;
+using wgs84::e2;
+
+//! square root for the constants, with Newton's method. std::sqrt isn't constexpr
+constexpr double root(double x) {
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 64; i++) {
+        r = 0.5 * (r + x / r);
+    }
+    return r;
+}
+
+//! first eccentricity
+constexpr double e = root(e2);
+
+// UTM
+constexpr double k0 = 0.9996;
+constexpr double false_easting = 500000.0;
+constexpr double false_northing = 10000000.0;
+
+// Krüger series, from the third flattening
+constexpr double n = f / (2.0 - f);
+constexpr double n2 = n * n;
+constexpr double n3 = n2 * n;
+constexpr double n4 = n3 * n;
+//! rectifying radius, times k0
+constexpr double k0_A = k0 * a / (1.0 + n) * (1.0 + n2 / 4.0 + n4 / 64.0);
+constexpr double alpha[4] = {
+    n / 2.0 - 2.0 * n2 / 3.0 + 5.0 * n3 / 16.0 + 41.0 * n4 / 180.0,
+    13.0 * n2 / 48.0 - 3.0 * n3 / 5.0 + 557.0 * n4 / 1440.0,
+    61.0 * n3 / 240.0 - 103.0 * n4 / 140.0,
+    49561.0 * n4 / 161280.0
+};
+
+inline double ellipsoid_height(const nmea::gga& fix) {
+    return static_cast<double>(fix.altitude) + static_cast<double>(fix.geoid_separation);
+}
+
+inline ecef ecef_of(double latitude, double longitude, double height) {
+    const double phi = latitude * degree;
+    const double lambda = longitude * degree;
+    const double sin_phi = std::sin(phi);
+    const double cos_phi = std::cos(phi);
+    const double N = a / std::sqrt(1.0 - e2 * sin_phi * sin_phi); // prime vertical radius
+    return {(N + height) * cos_phi * std::cos(lambda), (N + height) * cos_phi * std::sin(lambda),
+        (N * (1.0 - e2) + height) * sin_phi};
+}
+
+//! northing and easting, without false origin, relative to the central meridian
+inline void transverse_mercator(double latitude, double longitude, double central_meridian, double& easting, double& northing) {
+    const double sin_phi = std::sin(latitude * degree);
+    const double lambda = (longitude - central_meridian) * degree;
+    const double t = std::sinh(std::atanh(sin_phi) - e * std::atanh(e * sin_phi)); // conformal latitude
+    const double xi_ = std::atan2(t, std::cos(lambda));
+    const double eta_ = std::atanh(std::sin(lambda) / std::sqrt(1.0 + t * t));
+    double xi = xi_;
+    double eta = eta_;
+    for (int j = 0; j < 4; j++) {
+        const double k = 2.0 * (j + 1);
+        xi += alpha[j] * std::sin(k * xi_) * std::cosh(k * eta_);
+        eta += alpha[j] * std::cos(k * xi_) * std::sinh(k * eta_);
+    }
+    easting = k0_A * eta;
+    northing = k0_A * xi;
+}
+
+inline double central_meridian(uint8_t zone) {
+    return zone * 6.0 - 183.0;
+}
+
+} // namespace
+
+ecef to_ecef(double latitude, double longitude, double height) {
+    return ecef_of(latitude, longitude, height);
+}
+
+ecef to_ecef(const nmea::gga& fix) {
+    return ecef_of(fix.latitude, fix.longitude, ellipsoid_height(fix));
+}
+
+std::size_t to_ecef(std::span<const double> latitude, std::span<const double> longitude, std::span<const float> height,
+        const columns& out) {
+    TESEO_TRACE_SCOPE("geodesy: ecef");
+    // a short span limits the batch, instead of being read or written out of bounds
+    const std::size_t count = std::min({latitude.size(), longitude.size(), height.size(),
+        out.x.size(), out.y.size(), out.z.size()});
+    for (std::size_t i = 0; i < count; i++) {
+        const ecef p = ecef_of(latitude[i], longitude[i], height[i]);
+        out.x[i] = p.x;
+        out.y[i] = p.y;
+        out.z[i] = p.z;
+    }
+    return count;
+}
+
+local_frame::local_frame(double latitude, double longitude, double height) :
+    origin_(ecef_of(latitude, longitude, height)) {
+    const double sin_phi = std::sin(latitude * degree);
+    const double cos_phi = std::cos(latitude * degree);
+    const double sin_lambda = std::sin(longitude * degree);
+    const double cos_lambda = std::cos(longitude * degree);
+    // east
+    rotation_[0][0] = -sin_lambda;
+    rotation_[0][1] = cos_lambda;
+    rotation_[0][2] = 0.0;
+    // north
+    rotation_[1][0] = -sin_phi * cos_lambda;
+    rotation_[1][1] = -sin_phi * sin_lambda;
+    rotation_[1][2] = cos_phi;
+    // up
+    rotation_[2][0] = cos_phi * cos_lambda;
+    rotation_[2][1] = cos_phi * sin_lambda;
+    rotation_[2][2] = sin_phi;
+}
+
+local_frame::local_frame(const nmea::gga& fix) : local_frame(fix.latitude, fix.longitude, ellipsoid_height(fix)) {}
+
+enu local_frame::to_enu(const ecef& position) const {
+    const double dx = position.x - origin_.x;
+    const double dy = position.y - origin_.y;
+    const double dz = position.z - origin_.z;
+    return {rotation_[0][0] * dx + rotation_[0][1] * dy + rotation_[0][2] * dz,
+        rotation_[1][0] * dx + rotation_[1][1] * dy + rotation_[1][2] * dz,
+        rotation_[2][0] * dx + rotation_[2][1] * dy + rotation_[2][2] * dz};
+}
+
+enu local_frame::to_enu(double latitude, double longitude, double height) const {
+    return to_enu(ecef_of(latitude, longitude, height));
+}
+
+enu local_frame::to_enu(const nmea::gga& fix) const {
+    return to_enu(ecef_of(fix.latitude, fix.longitude, ellipsoid_height(fix)));
+}
+
+std::size_t local_frame::to_enu(std::span<const double> latitude, std::span<const double> longitude,
+        std::span<const float> height, const columns& out) const {
+    TESEO_TRACE_SCOPE("geodesy: enu");
+    const std::size_t count = to_ecef(latitude, longitude, height, out);
+    return to_enu(columns{out.x.first(count), out.y.first(count), out.z.first(count)});
+}
+
+std::size_t local_frame::to_enu(const columns& positions) const {
+    const std::size_t count = std::min({positions.x.size(), positions.y.size(), positions.z.size()});
+    // copies, so that the compiler knows that the rotation doesn't alias the output
+    const double r00 = rotation_[0][0], r01 = rotation_[0][1];
+    const double r10 = rotation_[1][0], r11 = rotation_[1][1], r12 = rotation_[1][2];
+    const double r20 = rotation_[2][0], r21 = rotation_[2][1], r22 = rotation_[2][2];
+    const ecef o = origin_;
+    double* __restrict x = positions.x.data();
+    double* __restrict y = positions.y.data();
+    double* __restrict z = positions.z.data();
+    for (std::size_t i = 0; i < count; i++) {
+        const double dx = x[i] - o.x;
+        const double dy = y[i] - o.y;
+        const double dz = z[i] - o.z;
+        x[i] = r00 * dx + r01 * dy;
+        y[i] = r10 * dx + r11 * dy + r12 * dz;
+        z[i] = r20 * dx + r21 * dy + r22 * dz;
+    }
+    return count;
+}
+
+uint8_t utm_zone(double latitude, double longitude) {
+    int zone = static_cast<int>(std::floor((longitude + 180.0) / 6.0)) % 60 + 1;
+    if (latitude >= 56.0 && latitude < 64.0 && longitude >= 3.0 && longitude < 12.0) {
+        zone = 32; // south west Norway
+    } else if (latitude >= 72.0 && latitude < 84.0 && longitude >= 0.0 && longitude < 42.0) {
+        // Svalbard: 31X, 33X, 35X and 37X
+        zone = longitude < 9.0 ? 31 : longitude < 21.0 ? 33 : longitude < 33.0 ? 35 : 37;
+    }
+    return static_cast<uint8_t>(zone);
+}
+
+utm to_utm(double latitude, double longitude, uint8_t zone) {
+    if (zone == 0) {
+        zone = utm_zone(latitude, longitude);
+    }
+    utm out {0.0, 0.0, zone, latitude >= 0.0};
+    transverse_mercator(latitude, longitude, central_meridian(zone), out.easting, out.northing);
+    out.easting += false_easting;
+    if (!out.north) {
+        out.northing += false_northing;
+    }
+    return out;
+}
+
+utm to_utm(const nmea::gga& fix, uint8_t zone) {
+    return to_utm(fix.latitude, fix.longitude, zone);
+}
+
+std::size_t to_utm(std::span<const double> latitude, std::span<const double> longitude, uint8_t zone,
+        std::span<double> easting, std::span<double> northing) {
+    TESEO_TRACE_SCOPE("geodesy: utm");
+    assert(zone >= 1 && zone <= 60);
+    const std::size_t count = std::min({latitude.size(), longitude.size(), easting.size(), northing.size()});
+    const double meridian = central_meridian(zone);
+    for (std::size_t i = 0; i < count; i++) {
+        double x;
+        double y;
+        transverse_mercator(latitude[i], longitude[i], meridian, x, y);
+        easting[i] = x + false_easting;
+        northing[i] = y + (latitude[i] < 0.0 ? false_northing : 0.0);
+    }
+    return count;
+}
+
+} // namespace geodesy
+
+} // namespace teseo
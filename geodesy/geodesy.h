@@ -0,0 +1,157 @@
+#ifndef GEODESY_H_
+#define GEODESY_H_
+
+#include <cstdint>
+#include <span>
+#include "nmea.h"
+
+namespace teseo {
+
+//! Coordinate transforms for decoded fixes: WGS84 to ECEF, ENU and UTM.
+/*!
+  Angles are in degrees, lengths in m. Heights are above the WGS84 ellipsoid: for a GGA fix, that's
+  altitude + geoid_separation. The gga overloads add them up.
+  The batch functions take structure of arrays input, e.g.: the columns of nmea::decode_batch(),
+  and write caller owned columns. They don't allocate. A batch transforms as many rows as its shortest span holds,
+  and returns that count.
+  The ECEF to ENU rotation loop vectorises. The ECEF and UTM loops call sin, cos, atanh and sinh per point, and
+  GCC leaves them scalar, also at -O3 -ffast-math: their gain is the saved call overhead and the cache friendly
+  layout, not SIMD.
+*/
+namespace geodesy {
+
+//! earth centered, earth fixed
+struct ecef {
+    double x;
+    double y;
+    double z;
+};
+
+//! local east, north, up
+struct enu {
+    double east;
+    double north;
+    double up;
+};
+
+//! universal transverse mercator
+struct utm {
+    double easting;
+    double northing;
+    //! 1 - 60
+    uint8_t zone;
+    bool north;
+};
+
+//! caller owned output columns for the batch transforms. All spans need room for the same number of rows.
+struct columns {
+    std::span<double> x;
+    std::span<double> y;
+    std::span<double> z;
+};
+
+//! WGS84 to ECEF
+/*!
+  \param latitude double degrees, positive north.
+  \param longitude double degrees, positive east.
+  \param height double above the ellipsoid, m.
+  \returns ecef the position
+*/
+ecef to_ecef(double latitude, double longitude, double height);
+
+//! GGA fix to ECEF. See to_ecef(double, double, double)
+ecef to_ecef(const nmea::gga& fix);
+
+//! WGS84 to ECEF, for many points
+/*!
+  \param latitude std::span<const double> degrees.
+  \param longitude std::span<const double> degrees.
+  \param height std::span<const float> above the ellipsoid, m.
+  \param out columns x, y and z get the ECEF positions.
+  \returns std::size_t number of rows written
+*/
+std::size_t to_ecef(std::span<const double> latitude, std::span<const double> longitude, std::span<const float> height,
+        const columns& out);
+
+//! Local tangent plane, around a reference point.
+/*!
+  The reference point's ECEF position and the ECEF to ENU rotation are computed once, in the constructor.
+  A transform then costs one ECEF conversion and a 3x3 rotation.
+*/
+class local_frame {
+public:
+
+    //! constructor.
+    /*!
+      \param latitude double degrees, of the reference point.
+      \param longitude double degrees.
+      \param height double above the ellipsoid, m.
+    */
+    local_frame(double latitude, double longitude, double height);
+
+    //! constructor, with a GGA fix as reference point
+    local_frame(const nmea::gga& fix);
+
+    //! ECEF to ENU
+    enu to_enu(const ecef& position) const;
+
+    //! WGS84 to ENU
+    enu to_enu(double latitude, double longitude, double height) const;
+
+    //! GGA fix to ENU
+    enu to_enu(const nmea::gga& fix) const;
+
+    //! WGS84 to ENU, for many points
+    /*!
+      \param latitude std::span<const double> degrees.
+      \param longitude std::span<const double> degrees.
+      \param height std::span<const float> above the ellipsoid, m.
+      \param out columns x, y and z get east, north and up.
+      \returns std::size_t number of rows written
+    */
+    std::size_t to_enu(std::span<const double> latitude, std::span<const double> longitude, std::span<const float> height,
+            const columns& out) const;
+
+    //! ECEF to ENU, in place, for many points. x, y and z become east, north and up. Returns the number of rows
+    std::size_t to_enu(const columns& positions) const;
+
+private:
+    ecef origin_;
+    //! rows of the ECEF to ENU rotation
+    double rotation_[3][3];
+};
+
+//! UTM zone of a position, with the Norway and Svalbard exceptions
+uint8_t utm_zone(double latitude, double longitude);
+
+//! WGS84 to UTM
+/*!
+  \param latitude double degrees, between -80 and 84.
+  \param longitude double degrees.
+  \param zone uint8_t forced zone, e.g.: to keep a track that crosses a zone border in one grid. 0: the position's zone.
+  \returns utm the position. mm accuracy within the zone and the next.
+
+  Krüger series, to the 4th order, with the coefficients precomputed for WGS84.
+*/
+utm to_utm(double latitude, double longitude, uint8_t zone = 0);
+
+//! GGA fix to UTM. See to_utm(double, double, uint8_t)
+utm to_utm(const nmea::gga& fix, uint8_t zone = 0);
+
+//! WGS84 to UTM, for many points, in one zone
+/*!
+  \param latitude std::span<const double> degrees.
+  \param longitude std::span<const double> degrees.
+  \param zone uint8_t the zone for all points. Use utm_zone() of the first point for a track.
+  \param easting std::span<double> gets the eastings.
+  \param northing std::span<double> gets the northings. Southern hemisphere points get the 10000 km false northing.
+  \returns std::size_t number of rows written
+*/
+std::size_t to_utm(std::span<const double> latitude, std::span<const double> longitude, uint8_t zone,
+        std::span<double> easting, std::span<double> northing);
+
+} // namespace geodesy
+
+} // namespace teseo
+
+#endif // GEODESY_H_
@@ -0,0 +1,31 @@
+#ifndef WGS84_H_
+#define WGS84_H_
+
+#include <numbers>
+
+namespace teseo {
+
+namespace geodesy {
+
+//! WGS84 ellipsoid, shared by the transforms and the distances
+namespace wgs84 {
+
+//! semi-major axis, m
+inline constexpr double a = 6378137.0;
+//! flattening
+inline constexpr double f = 1.0 / 298.257223563;
+//! semi-minor axis, m
+inline constexpr double b = a * (1.0 - f);
+//! first eccentricity, squared
+inline constexpr double e2 = f * (2.0 - f);
+
+} // namespace wgs84
+
+//! degrees to radians
+inline constexpr double degree = std::numbers::pi / 180.0;
+
+} // namespace geodesy
+
+} // namespace teseo
+
+#endif // WGS84_H_
@@ -0,0 +1,390 @@
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include "callbackmanager.h"
+#include "nmea.h"
+
+namespace teseo {
+
+//! Crash-safe black box journal of decoded fixes, in NOR flash.
+/*!
+  Each fix is a 32 byte record with a CRC. Records are collected in a RAM page, and written a page at a time
+  through the program() handler: one flash write per PageSize / 32 fixes, instead of one per fix.
+  The flash area is a ring of sectors. The first page of each sector holds a header with its sequence number and
+  erase count, written right after the erase. When a sector is full, the next one is erased and the journal moves on,
+  overwriting the oldest fixes. The sectors are erased in turn, so they all wear at the same rate. The erase stall
+  happens once per sector.
+
+  After power loss, recover() reads one header per sector to find the newest, and finds the first unwritten page
+  of that sector with a binary search: O(sectors + log(pages)) reads. Records that were in RAM are lost.
+  A page that was torn by the power loss fails its CRCs, and is skipped by replay(). A sector that was erased, but
+  whose header was not written yet, is erased again by recover(). Its erase count is then taken from the sector
+  before it.
+  flush() writes a partial page, e.g.: before a planned power down. The rest of that page stays erased and unused,
+  because a page can be programmed once between erases.
+
+  Addresses are byte offsets from the start of the journal area. Records are stored in host byte order.
+  Handlers, for instructions on how to register them, check the documentation of teseo::writer():
+  - program(): write one page. Callback parameters: uint32_t address, std::span<const uint8_t> PageSize bytes
+  - erase(): erase one sector. Callback parameters: uint32_t address of the sector
+  - read(): Callback parameters: uint32_t address, std::span<uint8_t> gets the data
+
+  Example code:
+  @code
+  teseo::journal<256> log({.sector_size = 4096, .sectors = 16});
+  log.program().set([](uint32_t address, std::span<const uint8_t> page) -> void {
+    flash_range_program(JOURNAL_OFFSET + address, page.data(), page.size());
+  });
+  log.erase().set([](uint32_t address) -> void { flash_range_erase(JOURNAL_OFFSET + address, 4096); });
+  log.read().set([](uint32_t address, std::span<uint8_t> data) -> void {
+    std::memcpy(data.data(), reinterpret_cast<const uint8_t*>(XIP_BASE + JOURNAL_OFFSET + address), data.size());
+  });
+  log.recover();
+  // per fix
+  log.append(gga, rmc);
+  @endcode
+*/
+template <std::size_t PageSize = 256>
+class journal {
+public:
+
+    //! one fix, as stored
+    struct record {
+        //! record number, counts up. 0xFFFFFFFF: erased flash
+        uint32_t sequence;
+        uint32_t utc_ms;
+        //! ddmmyy, 0 if unknown
+        uint32_t date;
+        //! 1e-7 degrees
+        int32_t latitude;
+        //! 1e-7 degrees
+        int32_t longitude;
+        //! above mean sea level, cm
+        int32_t altitude_cm;
+        //! cm/s
+        uint16_t speed_cms;
+        uint8_t quality;
+        uint8_t satellites;
+        //! CRC-32 of the bytes before it
+        uint32_t crc;
+    };
+    static_assert(sizeof(record) == 32);
+    static_assert(PageSize % sizeof(record) == 0);
+
+    //! flash layout of the journal area
+    struct geometry {
+        //! erase unit, bytes. A multiple of PageSize, at least 2 pages: the header page and a record page
+        uint32_t sector_size = 4096;
+        //! at least 2
+        uint32_t sectors = 16;
+    };
+
+    //! journal statistics
+    struct report {
+        unsigned long appended = 0;
+        unsigned long pages_written = 0;
+        unsigned long erases = 0;
+        //! records that failed their CRC during replay()
+        unsigned long corrupt = 0;
+    };
+
+    //! constructor.
+    /*!
+      \param layout geometry of the flash area.
+    */
+    journal(const geometry& layout) : layout_(layout), pages_per_sector_(layout.sector_size / PageSize),
+        page_(), fill_(0), sector_(0), sector_sequence_(0), erase_count_(0), next_page_(0), next_sequence_(0),
+        recovered_(false), report_() {
+        assert(layout.sectors >= 2 && layout.sector_size % PageSize == 0 && layout.sector_size >= 2 * PageSize);
+    }
+
+    //! expose the callback manager for programming a page
+    inline Callback<void, uint32_t, std::span<const uint8_t>>& program() {
+        return program_;
+    }
+
+    //! expose the callback manager for erasing a sector
+    inline Callback<void, uint32_t>& erase() {
+        return erase_;
+    }
+
+    //! expose the callback manager for reading
+    inline Callback<void, uint32_t, std::span<uint8_t>>& read() {
+        return read_;
+    }
+
+    //! expose the statistics
+    inline const report& statistics() const {
+        return report_;
+    }
+
+    //! erase count of the sector that is written now
+    inline uint32_t erase_count() const {
+        return erase_count_;
+    }
+
+    //! find where the journal left off. Call once, before append()
+    /*!
+      \returns bool true if an existing journal was found. false: the journal starts empty, in a freshly erased sector
+    */
+    bool recover() {
+        bool found = false;
+        for (uint32_t sector = 0; sector < layout_.sectors; sector++) {
+            header h;
+            if (read_header(sector, h) && (!found || h.sequence > sector_sequence_)) {
+                found = true;
+                sector_ = sector;
+                sector_sequence_ = h.sequence;
+                erase_count_ = h.erase_count;
+                next_sequence_ = h.first_record;
+            }
+        }
+        recovered_ = true;
+        if (!found) {
+            sector_ = layout_.sectors - 1;
+            next_sequence_ = 1;
+            rotate();
+            return false;
+        }
+
+        // the programmed pages are a prefix of the sector. Page 0 is the header
+        uint32_t low = 1;
+        uint32_t high = pages_per_sector_;
+        while (low < high) {
+            uint32_t middle = (low + high) / 2;
+            if (page_used(sector_, middle)) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        next_page_ = low;
+
+        // continue the numbering after the newest valid record, or at the header's if the sector has none
+        for (uint32_t page = next_page_; page-- > 1;) {
+            read_.call(address(sector_, page), page_);
+            bool valid = false;
+            for (std::size_t slot = 0; slot < slots_per_page_; slot++) {
+                record r;
+                if (page_record(slot, r)) {
+                    next_sequence_ = std::max(next_sequence_, r.sequence + 1);
+                    valid = true;
+                }
+            }
+            if (valid) {
+                break;
+            }
+        }
+        if (next_page_ == pages_per_sector_) {
+            rotate();
+        }
+        return true;
+    }
+
+    //! add a fix
+    /*!
+      \param fix nmea::gga const reference, position and quality.
+      \param motion nmea::rmc const reference, date and speed of the same fix.
+    */
+    void append(const nmea::gga& fix, const nmea::rmc& motion) {
+        record r = make_record(fix);
+        r.date = motion.date;
+        r.speed_cms = static_cast<uint16_t>(std::lround(std::min(motion.speed_knots * 51.4444f, 65535.0f)));
+        append(r);
+    }
+
+    //! add a fix without date and speed. See append(const nmea::gga&, const nmea::rmc&)
+    void append(const nmea::gga& fix) {
+        append(make_record(fix));
+    }
+
+    //! add a record. The sequence number and CRC are assigned here
+    void append(record r) {
+        assert(recovered_);
+        r.sequence = next_sequence_++;
+        r.crc = crc32(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&r), offsetof(record, crc)));
+        std::memcpy(page_.data() + fill_, &r, sizeof(r));
+        fill_ += sizeof(r);
+        report_.appended++;
+        if (fill_ == PageSize) {
+            flush();
+        }
+    }
+
+    //! write the records that are in RAM
+    void flush() {
+        if (fill_ == 0) {
+            return;
+        }
+        std::fill(page_.begin() + fill_, page_.end(), 0xFF); // left erased
+        program_.call(address(sector_, next_page_), page_);
+        report_.pages_written++;
+        fill_ = 0;
+        next_page_++;
+        if (next_page_ == pages_per_sector_) {
+            rotate();
+        }
+    }
+
+    //! read back the stored records, oldest first
+    /*!
+      \param visit called with a const record reference for each record with a valid CRC.
+      \returns unsigned long number of valid records
+
+      Only records that were written to flash are visited. Call flush() first to include the ones in RAM.
+      Uses the page buffer: don't call it while records are in RAM.
+    */
+    template <typename F>
+    unsigned long replay(F&& visit) {
+        assert(fill_ == 0);
+        unsigned long count = 0;
+        for (uint32_t i = 1; i <= layout_.sectors; i++) {
+            const uint32_t sector = (sector_ + i) % layout_.sectors; // the one after the newest is the oldest
+            header h;
+            if (!read_header(sector, h)) {
+                continue;
+            }
+            const uint32_t pages = (sector == sector_) ? next_page_ : pages_per_sector_;
+            for (uint32_t page = 1; page < pages; page++) {
+                read_.call(address(sector, page), page_);
+                for (std::size_t slot = 0; slot < slots_per_page_; slot++) {
+                    record r;
+                    if (page_record(slot, r)) {
+                        visit(static_cast<const record&>(r));
+                        count++;
+                    } else if (r.sequence != erased_) {
+                        report_.corrupt++;
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+private:
+
+    //! first slot of the first page of each sector. The rest of that page stays erased
+    struct header {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t erase_count;
+        //! sequence number of the first record of the sector
+        uint32_t first_record;
+        std::array<uint8_t, 12> reserved;
+        uint32_t crc;
+    };
+    static_assert(sizeof(header) == sizeof(record));
+
+    static constexpr uint32_t magic_ = 0x4C4E524A; // "JRNL"
+    static constexpr uint32_t erased_ = 0xFFFFFFFF;
+    static constexpr std::size_t slots_per_page_ = PageSize / sizeof(record);
+
+    static record make_record(const nmea::gga& fix) {
+        record r {};
+        r.utc_ms = fix.utc_ms;
+        r.latitude = static_cast<int32_t>(std::lround(fix.latitude * 1e7));
+        r.longitude = static_cast<int32_t>(std::lround(fix.longitude * 1e7));
+        r.altitude_cm = static_cast<int32_t>(std::lround(fix.altitude * 100.0f));
+        r.quality = fix.quality;
+        r.satellites = fix.satellites;
+        return r;
+    }
+
+    //! CRC-32 (IEEE 802.3), with a 16 entry table
+    static uint32_t crc32(std::span<const uint8_t> data) {
+        static constexpr std::array<uint32_t, 16> table {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+        };
+        uint32_t crc = 0xFFFFFFFF;
+        for (uint8_t byte : data) {
+            crc = (crc >> 4) ^ table[(crc ^ byte) & 0x0F];
+            crc = (crc >> 4) ^ table[(crc ^ (byte >> 4)) & 0x0F];
+        }
+        return ~crc;
+    }
+
+    inline uint32_t address(uint32_t sector, uint32_t page) const {
+        return sector * layout_.sector_size + page * PageSize;
+    }
+
+    bool read_header(uint32_t sector, header& h) {
+        std::array<uint8_t, sizeof(header)> bytes;
+        read_.call(address(sector, 0), bytes);
+        std::memcpy(&h, bytes.data(), sizeof(h));
+        return h.magic == magic_ &&
+            h.crc == crc32(std::span<const uint8_t>(bytes.data(), offsetof(header, crc)));
+    }
+
+    //! a page is used when its first slot is programmed
+    bool page_used(uint32_t sector, uint32_t page) {
+        std::array<uint8_t, sizeof(uint32_t)> bytes;
+        read_.call(address(sector, page), bytes);
+        uint32_t first;
+        std::memcpy(&first, bytes.data(), sizeof(first));
+        return first != erased_;
+    }
+
+    //! a record from page_
+    bool page_record(std::size_t slot, record& r) const {
+        std::memcpy(&r, page_.data() + slot * sizeof(record), sizeof(r));
+        if (r.sequence == erased_) {
+            return false;
+        }
+        return r.crc == crc32(std::span<const uint8_t>(page_.data() + slot * sizeof(record), offsetof(record, crc)));
+    }
+
+    //! erase the next sector, write its header, and start writing there
+    /*!
+      The header is written at once, so that a power loss before the first record page doesn't leave the newest
+      sector without one. Uses the page buffer: records in RAM must be flushed first.
+    */
+    void rotate() {
+        assert(fill_ == 0);
+        const uint32_t next = (sector_ + 1) % layout_.sectors;
+        header h;
+        erase_count_ = (read_header(next, h) ? h.erase_count : erase_count_) + 1;
+        erase_.call(address(next, 0));
+        report_.erases++;
+        sector_ = next;
+        sector_sequence_++;
+
+        h = {magic_, sector_sequence_, erase_count_, next_sequence_, {}, 0};
+        h.reserved.fill(0xFF);
+        h.crc = crc32(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&h), offsetof(header, crc)));
+        page_.fill(0xFF);
+        std::memcpy(page_.data(), &h, sizeof(h));
+        program_.call(address(sector_, 0), page_);
+        report_.pages_written++;
+        next_page_ = 1;
+    }
+
+    const geometry layout_;
+    const uint32_t pages_per_sector_;
+    Callback<void, uint32_t, std::span<const uint8_t>> program_;
+    Callback<void, uint32_t> erase_;
+    Callback<void, uint32_t, std::span<uint8_t>> read_;
+    //! the page that is being filled. Also the read buffer of recover() and replay()
+    std::array<uint8_t, PageSize> page_;
+    std::size_t fill_;
+    uint32_t sector_;
+    uint32_t sector_sequence_;
+    uint32_t erase_count_;
+    //! next page to program in the sector
+    uint32_t next_page_;
+    uint32_t next_sequence_;
+    bool recovered_;
+    report report_;
+};
+
+} // namespace teseo
+
+#endif // JOURNAL_H_
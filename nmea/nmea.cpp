@@ -0,0 +1,409 @@
+#include "nmea.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+
+namespace teseo {
+
+namespace nmea {
+
+namespace {
+
+//! the longest sentence that the decoders handle (RMC) has 13 fields after the address
+constexpr std::size_t max_fields = 20;
+
+using fields = std::array<std::string_view, max_fields>;
+
+inline uint8_t hex(char c);
+
+//! split the sentence in fields, and verify the checksum in the same pass.
+//! fields[0] is the address ("GPGGA"). Returns the field count, or 0 if not of type or if the checksum fails
+std::size_t split(std::string_view line, std::string_view type, fields& out) {
+    if (line.length() < 7 || line[0] != '$' || line.substr(3, 3) != type) {
+        return 0;
+    }
+    const char* data = line.data();
+    const std::size_t length = line.length();
+    std::size_t count = 0;
+    std::size_t start = 1;
+    std::size_t i = 1;
+    uint8_t sum = 0;
+    for (; i < length; i++) {
+        const char c = data[i];
+        if (c == '*' || c == '\r' || c == '\n') {
+            break;
+        }
+        sum ^= static_cast<uint8_t>(c);
+        if (c == ',') {
+            if (count < max_fields) {
+                out[count++] = std::string_view(data + start, i - start);
+            }
+            start = i + 1;
+        }
+    }
+    if (count < max_fields) {
+        out[count++] = std::string_view(data + start, i - start);
+    }
+    if (i < length && data[i] == '*') {
+        if (i + 2 >= length || hex(data[i + 1]) > 15 || hex(data[i + 2]) > 15 || sum != ((hex(data[i + 1]) << 4) | hex(data[i + 2]))) {
+            return 0;
+        }
+    }
+    for (std::size_t f = count; f < max_fields; f++) {
+        out[f] = std::string_view();
+    }
+    return count;
+}
+
+inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+uint32_t parse_uint(std::string_view s) {
+    uint32_t value = 0;
+    for (char c : s) {
+        if (!is_digit(c)) {
+            break;
+        }
+        value = value * 10 + static_cast<uint32_t>(c - '0');
+    }
+    return value;
+}
+
+//! decimal number without exponent. Integer arithmetic for the digits, one scaling at the end
+double parse_decimal(std::string_view s) {
+    static constexpr std::array<double, 10> scale {1.0, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9};
+    bool negative = !s.empty() && s[0] == '-';
+    uint64_t digits = 0;
+    std::size_t decimals = 0;
+    bool fraction = false;
+    for (std::size_t i = negative ? 1 : 0; i < s.length(); i++) {
+        char c = s[i];
+        if (c == '.' && !fraction) {
+            fraction = true;
+        } else if (is_digit(c) && decimals < scale.size() - 1) {
+            digits = digits * 10 + static_cast<uint64_t>(c - '0');
+            decimals += fraction;
+        } else {
+            break;
+        }
+    }
+    double value = static_cast<double>(digits) * scale[decimals];
+    return negative ? -value : value;
+}
+
+//! hhmmss.sss to ms since midnight
+uint32_t parse_utc(std::string_view s) {
+    if (s.length() < 6) {
+        return 0;
+    }
+    uint32_t seconds = parse_uint(s.substr(0, 2)) * 3600 + parse_uint(s.substr(2, 2)) * 60 + parse_uint(s.substr(4, 2));
+    return seconds * 1000 + static_cast<uint32_t>(parse_decimal(s.substr(6)) * 1000.0 + 0.5);
+}
+
+//! (d)ddmm.mmmm and hemisphere to degrees
+double parse_coordinate(std::string_view value, std::string_view hemisphere) {
+    double raw = parse_decimal(value);
+    double degrees = static_cast<double>(static_cast<uint32_t>(raw / 100.0));
+    degrees += (raw - degrees * 100.0) / 60.0;
+    return (!hemisphere.empty() && (hemisphere[0] == 'S' || hemisphere[0] == 'W')) ? -degrees : degrees;
+}
+
+inline bool is_a(std::string_view s) {
+    return !s.empty() && s[0] == 'A';
+}
+
+inline uint8_t hex(char c) {
+    return static_cast<uint8_t>(is_digit(c) ? c - '0' : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : 0xff);
+}
+
+//! appends fields to a caller provided buffer. Once it runs out of space, it stops writing, and finish() returns 0
+class sentence_writer {
+public:
+    sentence_writer(std::span<char> buffer, std::string_view talker, std::string_view type) :
+        begin_(buffer.data()), p_(buffer.data()), end_(buffer.data() + buffer.size()), ok_(true) {
+        put('$');
+        put(talker);
+        put(type);
+    }
+
+    void put(char c) {
+        if (p_ < end_) {
+            *p_++ = c;
+        } else {
+            ok_ = false;
+        }
+    }
+
+    void put(std::string_view s) {
+        for (char c : s) {
+            put(c);
+        }
+    }
+
+    //! unsigned integer, zero padded to width
+    void put_uint(uint64_t value, unsigned int width) {
+        char digits[20];
+        auto [last, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+        for (auto length = static_cast<unsigned int>(last - digits); length < width; length++) {
+            put('0');
+        }
+        put(std::string_view(digits, static_cast<std::size_t>(last - digits)));
+    }
+
+    //! fixed point number: integer part zero padded to width, and decimals
+    void put_fixed(double value, unsigned int decimals, unsigned int width = 1) {
+        static constexpr std::array<uint64_t, 7> scale {1, 10, 100, 1000, 10000, 100000, 1000000};
+        if (value < 0.0) {
+            put('-');
+            value = -value;
+        }
+        uint64_t scaled = static_cast<uint64_t>(std::llround(value * static_cast<double>(scale[decimals])));
+        put_uint(scaled / scale[decimals], width);
+        if (decimals) {
+            put('.');
+            put_uint(scaled % scale[decimals], decimals);
+        }
+    }
+
+    //! degrees to (d)ddmm.mmmmm,hemisphere
+    void put_coordinate(double degrees, bool latitude) {
+        const char hemisphere = latitude ? (degrees < 0.0 ? 'S' : 'N') : (degrees < 0.0 ? 'W' : 'E');
+        degrees = std::fabs(degrees);
+        // round in minutes first, so that 59.999995 minutes carries into the degrees
+        uint64_t minutes = static_cast<uint64_t>(std::llround(degrees * 60.0 * 100000.0));
+        put_uint(minutes / (60 * 100000), latitude ? 2 : 3);
+        put_fixed(static_cast<double>(minutes % (60 * 100000)) / 100000.0, 5, 2);
+        put(',');
+        put(hemisphere);
+    }
+
+    //! ms since midnight to hhmmss.sss
+    void put_utc(uint32_t ms) {
+        put_uint(ms / 3600000, 2);
+        put_uint(ms / 60000 % 60, 2);
+        put_uint(ms / 1000 % 60, 2);
+        put('.');
+        put_uint(ms % 1000, 3);
+    }
+
+    //! append the checksum and "\r\n". Returns the sentence length, or 0 if it didn't fit
+    std::size_t finish() {
+        uint8_t sum = 0;
+        for (const char* c = begin_ + 1; c < p_; c++) {
+            sum ^= static_cast<uint8_t>(*c);
+        }
+        static constexpr std::string_view hex_digits = "0123456789ABCDEF";
+        put('*');
+        put(hex_digits[sum >> 4]);
+        put(hex_digits[sum & 0x0f]);
+        put("\r\n");
+        return ok_ ? static_cast<std::size_t>(p_ - begin_) : 0;
+    }
+
+private:
+    char* begin_;
+    char* p_;
+    char* end_;
+    bool ok_;
+};
+
+} // namespace
+
+bool checksum_ok(std::string_view line) {
+    std::size_t star = line.find('*');
+    if (star == std::string_view::npos) {
+        return true;
+    }
+    if (star + 2 >= line.length()) {
+        return false;
+    }
+    uint8_t sum = 0;
+    for (std::size_t i = (line[0] == '$' ? 1 : 0); i < star; i++) {
+        sum ^= static_cast<uint8_t>(line[i]);
+    }
+    uint8_t high = hex(line[star + 1]);
+    uint8_t low = hex(line[star + 2]);
+    return high < 16 && low < 16 && sum == ((high << 4) | low);
+}
+
+bool decode(std::string_view line, gga& out) {
+    TESEO_TRACE_SCOPE("decode GGA");
+    fields f;
+    if (split(line, "GGA", f) < 10) {
+        return false;
+    }
+    out.utc_ms = parse_utc(f[1]);
+    out.latitude = parse_coordinate(f[2], f[3]);
+    out.longitude = parse_coordinate(f[4], f[5]);
+    out.quality = static_cast<uint8_t>(parse_uint(f[6]));
+    out.satellites = static_cast<uint8_t>(parse_uint(f[7]));
+    out.hdop = static_cast<float>(parse_decimal(f[8]));
+    out.altitude = static_cast<float>(parse_decimal(f[9]));
+    out.geoid_separation = static_cast<float>(parse_decimal(f[11]));
+    return true;
+}
+
+bool decode(std::string_view line, rmc& out) {
+    TESEO_TRACE_SCOPE("decode RMC");
+    fields f;
+    if (split(line, "RMC", f) < 10) {
+        return false;
+    }
+    out.utc_ms = parse_utc(f[1]);
+    out.valid = is_a(f[2]);
+    out.latitude = parse_coordinate(f[3], f[4]);
+    out.longitude = parse_coordinate(f[5], f[6]);
+    out.speed_knots = static_cast<float>(parse_decimal(f[7]));
+    out.course = static_cast<float>(parse_decimal(f[8]));
+    out.date = parse_uint(f[9]);
+    out.magnetic_variation = static_cast<float>(parse_decimal(f[10]));
+    if (!f[11].empty() && f[11][0] == 'W') {
+        out.magnetic_variation = -out.magnetic_variation;
+    }
+    return true;
+}
+
+bool decode(std::string_view line, vtg& out) {
+    TESEO_TRACE_SCOPE("decode VTG");
+    fields f;
+    if (split(line, "VTG", f) < 8) {
+        return false;
+    }
+    out.course_true = static_cast<float>(parse_decimal(f[1]));
+    out.course_magnetic = static_cast<float>(parse_decimal(f[3]));
+    out.speed_knots = static_cast<float>(parse_decimal(f[5]));
+    out.speed_kmh = static_cast<float>(parse_decimal(f[7]));
+    return true;
+}
+
+bool decode(std::string_view line, gll& out) {
+    TESEO_TRACE_SCOPE("decode GLL");
+    fields f;
+    if (split(line, "GLL", f) < 7) {
+        return false;
+    }
+    out.latitude = parse_coordinate(f[1], f[2]);
+    out.longitude = parse_coordinate(f[3], f[4]);
+    out.utc_ms = parse_utc(f[5]);
+    out.valid = is_a(f[6]);
+    return true;
+}
+
+std::size_t encode(const gga& in, std::span<char> buffer, std::string_view talker) {
+    sentence_writer w(buffer, talker, "GGA,");
+    w.put_utc(in.utc_ms);
+    w.put(',');
+    if (in.quality) {
+        w.put_coordinate(in.latitude, true);
+        w.put(',');
+        w.put_coordinate(in.longitude, false);
+    } else {
+        w.put(",,,"); // no fix: no position
+    }
+    w.put(',');
+    w.put_uint(in.quality, 1);
+    w.put(',');
+    w.put_uint(in.satellites, 2);
+    w.put(',');
+    w.put_fixed(in.hdop, 1);
+    w.put(',');
+    if (in.quality) {
+        w.put_fixed(in.altitude, 1);
+    }
+    w.put(",M,");
+    if (in.quality) {
+        w.put_fixed(in.geoid_separation, 1);
+    }
+    w.put(",M,,");
+    return w.finish();
+}
+
+std::size_t encode(const rmc& in, std::span<char> buffer, std::string_view talker) {
+    sentence_writer w(buffer, talker, "RMC,");
+    w.put_utc(in.utc_ms);
+    w.put(in.valid ? ",A," : ",V,");
+    w.put_coordinate(in.latitude, true);
+    w.put(',');
+    w.put_coordinate(in.longitude, false);
+    w.put(',');
+    w.put_fixed(in.speed_knots, 1, 3);
+    w.put(',');
+    w.put_fixed(in.course, 1, 3);
+    w.put(',');
+    w.put_uint(in.date, 6);
+    w.put(',');
+    w.put_fixed(std::fabs(in.magnetic_variation), 1, 3);
+    w.put(in.magnetic_variation < 0.0f ? ",W" : ",E");
+    return w.finish();
+}
+
+std::size_t encode(const vtg& in, std::span<char> buffer, std::string_view talker) {
+    sentence_writer w(buffer, talker, "VTG,");
+    w.put_fixed(in.course_true, 1, 3);
+    w.put(",T,");
+    w.put_fixed(in.course_magnetic, 1, 3);
+    w.put(",M,");
+    w.put_fixed(in.speed_knots, 1, 3);
+    w.put(",N,");
+    w.put_fixed(in.speed_kmh, 1, 3);
+    w.put(",K");
+    return w.finish();
+}
+
+std::size_t encode(const gll& in, std::span<char> buffer, std::string_view talker) {
+    sentence_writer w(buffer, talker, "GLL,");
+    w.put_coordinate(in.latitude, true);
+    w.put(',');
+    w.put_coordinate(in.longitude, false);
+    w.put(',');
+    w.put_utc(in.utc_ms);
+    w.put(in.valid ? ",A,A" : ",V,N");
+    return w.finish();
+}
+
+std::size_t decode_batch(std::span<const std::string_view> lines, std::span<const uint32_t> devices, const fix_columns& out) {
+    // a short column or device list limits the batch, instead of being written or read out of bounds
+    const std::size_t capacity = std::min({out.utc_ms.size(), out.latitude.size(), out.longitude.size(),
+        out.speed_knots.size(), out.quality.size(), out.device.size()});
+    const std::size_t count = std::min(lines.size(), devices.size());
+    std::size_t rows = 0;
+    gga g; // intentionally uninitialised
+    rmc r; // intentionally uninitialised
+    for (std::size_t i = 0; i < count && rows < capacity; i++) {
+        const std::string_view line = lines[i];
+        if (line.length() < 7) {
+            continue;
+        }
+        const std::string_view type = line.substr(3, 3);
+        if (type == "GGA" && decode(line, g)) {
+            out.utc_ms[rows] = g.utc_ms;
+            out.latitude[rows] = g.latitude;
+            out.longitude[rows] = g.longitude;
+            out.speed_knots[rows] = 0.0f;
+            out.quality[rows] = g.quality;
+        } else if (type == "RMC" && decode(line, r)) {
+            out.utc_ms[rows] = r.utc_ms;
+            out.latitude[rows] = r.latitude;
+            out.longitude[rows] = r.longitude;
+            out.speed_knots[rows] = r.speed_knots;
+            out.quality[rows] = r.valid ? 1 : 0;
+        } else {
+            continue;
+        }
+        out.device[rows] = devices[i];
+        rows++;
+    }
+    return rows;
+}
+
+} // namespace nmea
+
+} // namespace teseo
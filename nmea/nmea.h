@@ -0,0 +1,154 @@
+#ifndef NMEA_H_
+#define NMEA_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <span>
+
+namespace teseo {
+
+//! Decoders for the NMEA sentences that the Teseo returns.
+/*!
+  The decoders work on std::string_view. They don't allocate, and don't depend on the locale.
+  When a sentence has a checksum, it is verified. Empty fields decode as 0.
+  Latitude and longitude are in degrees: positive north and east.
+  UTC time is in milliseconds since midnight.
+*/
+namespace nmea {
+
+//! GGA: fix data
+struct gga {
+    uint32_t utc_ms;
+    double latitude;
+    double longitude;
+    //! 0: no fix, 1: GPS, 2: DGPS, ...
+    uint8_t quality;
+    uint8_t satellites;
+    float hdop;
+    //! above mean sea level, m
+    float altitude;
+    //! geoid above the WGS84 ellipsoid, m
+    float geoid_separation;
+};
+
+//! RMC: recommended minimum data
+struct rmc {
+    uint32_t utc_ms;
+    //! status A
+    bool valid;
+    double latitude;
+    double longitude;
+    float speed_knots;
+    //! course over ground, degrees true
+    float course;
+    //! ddmmyy, as in the sentence
+    uint32_t date;
+    //! magnetic variation, degrees. Positive east
+    float magnetic_variation;
+};
+
+//! VTG: course and speed
+struct vtg {
+    //! degrees true
+    float course_true;
+    //! degrees magnetic
+    float course_magnetic;
+    float speed_knots;
+    float speed_kmh;
+};
+
+//! GLL: geographic position
+struct gll {
+    double latitude;
+    double longitude;
+    uint32_t utc_ms;
+    //! status A
+    bool valid;
+};
+
+//! decode a GGA sentence
+/*!
+  \param line std::string_view the sentence, with or without "\r\n".
+  \param out gga reference gets the decoded data.
+  \returns bool true if the line is a GGA sentence with a valid checksum
+*/
+bool decode(std::string_view line, gga& out);
+
+//! decode a RMC sentence. See decode(std::string_view, gga&)
+bool decode(std::string_view line, rmc& out);
+
+//! decode a VTG sentence. See decode(std::string_view, gga&)
+bool decode(std::string_view line, vtg& out);
+
+//! decode a GLL sentence. See decode(std::string_view, gga&)
+bool decode(std::string_view line, gll& out);
+
+//! verify the checksum of a sentence
+/*!
+  \param line std::string_view the sentence.
+  \returns bool true if the checksum matches, or if the sentence has none
+*/
+bool checksum_ok(std::string_view line);
+
+//! longest NMEA sentence, "$" to "\r\n" included. A buffer of this size fits every encode()
+constexpr std::size_t max_sentence_length = 82;
+
+//! encode a GGA sentence, with checksum and "\r\n"
+/*!
+  \param in gga const reference with the data.
+  \param buffer std::span<char> caller provided buffer. Not null terminated.
+  \param talker std::string_view talker ID. Default "GP".
+  \returns std::size_t number of characters written. 0 if the buffer is too small.
+
+  Uses integer std::to_chars only: no allocation, no locale, no floating point formatting.
+  Coordinates get 5 decimals of minutes, as the Teseo sends them. Without fix (quality 0), the position, altitude
+  and geoid separation fields are left empty, as in the Teseo's GGA before the first fix.
+*/
+std::size_t encode(const gga& in, std::span<char> buffer, std::string_view talker = "GP");
+
+//! encode a RMC sentence. See encode(const gga&, std::span<char>, std::string_view)
+/*!
+  Speed, course and magnetic variation get 3 integer digits, zero padded: "005.5".
+*/
+std::size_t encode(const rmc& in, std::span<char> buffer, std::string_view talker = "GP");
+
+//! encode a VTG sentence. See encode(const gga&, std::span<char>, std::string_view)
+/*!
+  Courses and speeds get 3 integer digits, zero padded: "054.7,T,034.4,M,005.5,N,010.2,K".
+*/
+std::size_t encode(const vtg& in, std::span<char> buffer, std::string_view talker = "GP");
+
+//! encode a GLL sentence. See encode(const gga&, std::span<char>, std::string_view)
+std::size_t encode(const gll& in, std::span<char> buffer, std::string_view talker = "GP");
+
+//! Caller owned output columns for decode_batch(). All spans need room for the same number of rows.
+struct fix_columns {
+    std::span<uint32_t> utc_ms;
+    std::span<double> latitude;
+    std::span<double> longitude;
+    //! knots. 0 for GGA lines
+    std::span<float> speed_knots;
+    //! GGA fix quality. RMC: 1 if status A, else 0
+    std::span<uint8_t> quality;
+    //! index of the device that sent the line
+    std::span<uint32_t> device;
+};
+
+//! decode GGA and RMC lines from many devices into columns
+/*!
+  \param lines std::span<const std::string_view> the sentences, from any number of devices.
+  \param devices std::span<const uint32_t> device index of each line. Lines beyond its size are not decoded.
+  \param out fix_columns the output columns. The shortest column sets the number of rows.
+  \returns std::size_t number of rows written. Lines that are not GGA or RMC, or that fail to decode, are skipped.
+
+  Structure of arrays output, for bulk ingest on servers. Each line is decoded in one pass over its bytes,
+  without allocation. Stops when the output is full.
+*/
+std::size_t decode_batch(std::span<const std::string_view> lines, std::span<const uint32_t> devices, const fix_columns& out);
+
+} // namespace nmea
+
+} // namespace teseo
+
+#endif // NMEA_H_
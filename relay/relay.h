@@ -0,0 +1,276 @@
+#ifndef RELAY_H_
+#define RELAY_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include "callbackmanager.h"
+#include "teseo.h"
+
+namespace teseo {
+
+//! Zero-copy NMEA relay and multiplexer.
+/*!
+  Frames the Teseo output into sentences, and forwards them to up to Outputs destinations, each with its own nmea_filter.
+  Each sentence is stored once, in a shared ring buffer of Capacity bytes. The filters are evaluated once per sentence,
+  when it is framed. A sentence that no output wants isn't stored.  
+  Each output has its own cursor. pump() hands the output's pending sentences to its writer handler as a list of
+  string_views that point into the ring: a scatter-gather write, e.g.: with writev(). The writer returns the number of
+  bytes it accepted. It should not block: a slow output falls behind, and when the ring overwrites its sentences,
+  they are dropped for that output only. Other outputs and push() are not affected. A sentence that is lost while
+  partly written leaves a truncated line on that output. The relay ends it with "\r\n", so that NMEA listeners
+  reject it by its checksum, and the next sentence starts on its own line.  
+  push() and pump() are called from the same thread.
+
+  Example code:
+  @code
+  teseo::relay<> relay;
+  static constexpr std::array<std::string_view, 2> position {"GGA", "RMC"};
+  relay.filter(0, {.sentences = position});
+  relay.output(0).set([fd](std::span<const std::string_view> pieces) -> std::size_t {
+    std::array<iovec, teseo::relay<>::max_pieces> iov;
+    for (std::size_t i = 0; i < pieces.size(); i++) {
+      iov[i] = {const_cast<char*>(pieces[i].data()), pieces[i].size()};
+    }
+    ssize_t written = writev(fd, iov.data(), pieces.size()); // fd is non-blocking
+    return written > 0 ? written : 0;
+  });
+  // loop
+  relay.push(bytes_from_teseo);
+  relay.pump_all();
+  @endcode
+*/
+template <std::size_t Capacity = 4096, std::size_t Sentences = 64, std::size_t Outputs = 4>
+requires (Outputs <= 32)
+class relay {
+public:
+
+    //! most pieces handed to a writer in one call
+    static constexpr std::size_t max_pieces = 16;
+    //! longest sentence, "\r\n" included. Longer lines are discarded
+    static constexpr std::size_t max_sentence = 82;
+
+    //! writer handler: gets the pieces to write, returns the number of bytes written
+    using writer = Callback<std::size_t, std::span<const std::string_view>>;
+
+    //! output statistics
+    struct output_statistics {
+        //! sentences completely written
+        unsigned long sentences = 0;
+        //! sentences that its filter accepted, dropped because the output fell behind
+        unsigned long dropped = 0;
+    };
+
+    relay() : bytes_(), byte_head_(0), sentences_(), sentence_head_(0), partial_(), partial_length_(0), discarding_(false),
+        outputs_() {}
+
+    //! expose the callback manager for the writer of an output
+    inline writer& output(std::size_t index) {
+        return outputs_[index].write;
+    }
+
+    //! set the filter of an output. The filter's sets are not copied, and have to outlive the relay.
+    inline void filter(std::size_t index, const nmea_filter& filter) {
+        outputs_[index].filter = filter;
+    }
+
+    //! expose the statistics of an output
+    inline const output_statistics& statistics(std::size_t index) const {
+        return outputs_[index].statistics;
+    }
+
+    //! frame incoming bytes into sentences
+    /*!
+      \param bytes std::string_view data read from the Teseo. Sentences can be split over calls.
+    */
+    void push(std::string_view bytes) {
+        for (char c : bytes) {
+            if (c == '$') { // start of sentence. Drops a partial one that didn't end
+                partial_length_ = 0;
+                discarding_ = false;
+            }
+            if (discarding_) {
+                continue;
+            }
+            if (partial_length_ == max_sentence) { // too long
+                discarding_ = true;
+                partial_length_ = 0;
+                continue;
+            }
+            partial_[partial_length_++] = c;
+            if (c == '\n') {
+                commit();
+            }
+        }
+    }
+
+    //! write pending sentences to an output
+    /*!
+      \param index std::size_t the output.
+      \returns bool true if the output has no more pending sentences
+    */
+    bool pump(std::size_t index) {
+        destination& o = outputs_[index];
+        skip_lost(o);
+
+        std::array<std::string_view, max_pieces> pieces;
+        std::size_t count = 0;
+        if (o.terminate) { // end the cut sentence first
+            pieces[count++] = crlf.substr(crlf.length() - o.terminate);
+        }
+        uint64_t sequence = o.next;
+        std::size_t offset = o.offset;
+        for (; sequence < sentence_head_ && count + 2 <= max_pieces; sequence++, offset = 0) {
+            const sentence& s = sentences_[sequence % Sentences];
+            if (!(s.outputs & (1u << index))) {
+                continue;
+            }
+            count += view(s.start + offset, s.length - offset, pieces.data() + count);
+        }
+        if (count == 0) {
+            o.next = sequence; // only filtered sentences were pending
+            o.offset = 0;
+            return true;
+        }
+
+        std::size_t written = o.write.call(std::span<const std::string_view>(pieces.data(), count));
+        const std::size_t ended = std::min(written, o.terminate);
+        o.terminate -= ended;
+        written -= ended;
+
+        // advance the cursor over the bytes that were written
+        for (; o.next < sequence; o.next++, o.offset = 0) {
+            const sentence& s = sentences_[o.next % Sentences];
+            if (!(s.outputs & (1u << index))) {
+                continue;
+            }
+            std::size_t left = s.length - o.offset;
+            if (written < left) {
+                o.offset += written;
+                break;
+            }
+            written -= left;
+            o.statistics.sentences++;
+        }
+        return o.next == sentence_head_ && o.terminate == 0;
+    }
+
+    //! pump all outputs once
+    void pump_all() {
+        for (std::size_t index = 0; index < Outputs; index++) {
+            pump(index);
+        }
+    }
+
+private:
+
+    struct sentence {
+        //! position in the byte stream. The ring index is start % Capacity
+        uint64_t start;
+        std::size_t length;
+        //! bit per output that wants the sentence
+        uint32_t outputs;
+    };
+
+    struct destination {
+        writer write;
+        nmea_filter filter;
+        //! sequence number of the next sentence to write
+        uint64_t next = 0;
+        //! bytes of that sentence that are already written
+        std::size_t offset = 0;
+        //! bytes of "\r\n" still to write, after a sentence that was lost while partly written
+        std::size_t terminate = 0;
+        //! sentences stored for this output since the start
+        uint64_t wanted = 0;
+        output_statistics statistics;
+    };
+
+    //! store the framed sentence, if an output wants it
+    void commit() {
+        const std::string_view line(partial_.data(), partial_length_);
+        partial_length_ = 0;
+        if (line.length() < 7 || line[0] != '$') {
+            return;
+        }
+        uint32_t wanted = 0;
+        for (std::size_t index = 0; index < Outputs; index++) {
+            if (outputs_[index].write.is_set() && outputs_[index].filter.accept(line)) {
+                wanted |= 1u << index;
+                outputs_[index].wanted++;
+            }
+        }
+        if (!wanted) {
+            return;
+        }
+        for (std::size_t i = 0; i < line.length(); i++) {
+            bytes_[(byte_head_ + i) % Capacity] = line[i];
+        }
+        sentences_[sentence_head_ % Sentences] = {byte_head_, line.length(), wanted};
+        byte_head_ += line.length();
+        sentence_head_++;
+    }
+
+    //! move the cursor of an output that fell behind to the oldest sentence that is still in the ring
+    void skip_lost(destination& o) {
+        uint64_t oldest = sentence_head_ > Sentences ? sentence_head_ - Sentences : 0;
+        uint64_t oldest_byte = byte_head_ > Capacity ? byte_head_ - Capacity : 0;
+        const uint32_t bit = 1u << static_cast<uint32_t>(&o - outputs_.data());
+        if (o.next < oldest) {
+            // their records are overwritten too. Every wanted sentence before the cursor is written or dropped,
+            // so the lost ones are the wanted ones that are neither, and not in the ring
+            uint64_t kept = 0;
+            for (uint64_t sequence = oldest; sequence < sentence_head_; sequence++) {
+                kept += (sentences_[sequence % Sentences].outputs & bit) ? 1 : 0;
+            }
+            o.statistics.dropped = o.wanted - kept - o.statistics.sentences;
+            cut(o);
+            o.next = oldest;
+        }
+        while (o.next < sentence_head_ && sentences_[o.next % Sentences].start < oldest_byte) {
+            o.statistics.dropped += (sentences_[o.next % Sentences].outputs & bit) ? 1 : 0;
+            cut(o);
+            o.next++;
+        }
+    }
+
+    //! the sentence under the cursor is lost. If it was partly written, its line has to be ended
+    void cut(destination& o) {
+        if (o.offset) {
+            o.terminate = crlf.length();
+            o.offset = 0;
+        }
+    }
+
+    //! the ring bytes [start, start + length) as one or two views. Returns the number of views
+    std::size_t view(uint64_t start, std::size_t length, std::string_view* out) const {
+        std::size_t index = start % Capacity;
+        std::size_t first = std::min(length, Capacity - index);
+        out[0] = std::string_view(bytes_.data() + index, first);
+        if (first == length) {
+            return 1;
+        }
+        out[1] = std::string_view(bytes_.data(), length - first);
+        return 2;
+    }
+
+    static constexpr std::string_view crlf = "\r\n";
+
+    std::array<char, Capacity> bytes_;
+    //! bytes stored since the start
+    uint64_t byte_head_;
+    std::array<sentence, Sentences> sentences_;
+    //! sentences stored since the start
+    uint64_t sentence_head_;
+    std::array<char, max_sentence> partial_;
+    std::size_t partial_length_;
+    //! skipping a line that is too long
+    bool discarding_;
+    std::array<destination, Outputs> outputs_;
+};
+
+} // namespace teseo
+
+#endif // RELAY_H_
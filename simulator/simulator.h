@@ -0,0 +1,252 @@
+#ifndef SIMULATOR_H_
+#define SIMULATOR_H_
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+namespace teseo {
+
+//! Host side Teseo simulator, with fault injection.
+/*!
+  Replaces the I2C or UART link when the driver runs on a development host.
+  Register write() and read() as the teseo writer and reader handlers, and reset() as resetter.
+  Replies to $PSTMNMEAREQUEST with canned sentences and the status line, like the Teseo does.
+  $PSTMGPSRESTART is acknowledged. $PSTMFORCESTANDBY starts a simulated hot start, see hot_start_requests().
+  $PSTMSETCONSTMASK selects the constellations: each one adds GSV lines, and raises the load in the $PSTMCPU reply.
+  Other commands are accepted without reply.
+
+  Faults are injected per read() with the probabilities set in faults(). The random generator is seeded,
+  so that a run can be repeated. Each injected fault is counted in injected().
+
+  Example code:
+  @code
+  teseo::simulator sim;
+  sim.faults().bit_flip = 0.01;
+  teseo::teseo gps;
+  gps.writer().set([&sim](const std::string& s) -> void { sim.write(s); });
+  gps.reader().set([&sim](std::string& s) -> void { sim.read(s); });
+  gps.resetter().set([&sim]() -> void { sim.reset(); });
+  @endcode
+*/
+class simulator {
+public:
+
+    //! probability (0.0 - 1.0) that a read() suffers a fault of that kind
+    struct fault_rates {
+        //! flip a random bit in the reply
+        double bit_flip = 0.0;
+        //! cut the reply at a random position
+        double truncate = 0.0;
+        //! insert an unsolicited sentence between two reply lines
+        double interleave = 0.0;
+        //! return nothing, as if the Teseo doesn't answer in time
+        double stall = 0.0;
+        //! return a burst of 0xFF, as an idle I2C bus does
+        double ff_flood = 0.0;
+        //! drop the status line at the end of the reply
+        double missing_status = 0.0;
+    };
+
+    //! number of faults injected, per kind
+    struct fault_counts {
+        unsigned long bit_flip = 0;
+        unsigned long truncate = 0;
+        unsigned long interleave = 0;
+        unsigned long stall = 0;
+        unsigned long ff_flood = 0;
+        unsigned long missing_status = 0;
+    };
+
+    //! constructor.
+    /*!
+      \param seed unsigned int seed for the fault generator.
+    */
+    simulator(unsigned int seed = 1) : rates_(), counts_(), random_(seed), pending_(),
+        hot_start_requests_(0), acquiring_(0), standbys_(0), constellations_(0x1) {}
+
+    //! expose the fault rates, to configure the injection
+    inline fault_rates& faults() {
+        return rates_;
+    }
+
+    //! expose the count of injected faults
+    inline const fault_counts& injected() const {
+        return counts_;
+    }
+
+    //! expose the number of requests after a standby, that report no fix yet
+    /*!
+      Models the hot start after $PSTMFORCESTANDBY. Default 0: the fix is back at the first request.
+    */
+    inline unsigned int& hot_start_requests() {
+        return hot_start_requests_;
+    }
+
+    //! number of $PSTMFORCESTANDBY commands received
+    inline unsigned long standbys() const {
+        return standbys_;
+    }
+
+    //! constellation mask of the last $PSTMSETCONSTMASK. Default 0x1: GPS
+    inline unsigned int constellations() const {
+        return constellations_;
+    }
+
+    //! writer handler: accept a command
+    /*!
+      \param s constant std::string reference with the command.
+    */
+    void write(const std::string& s) {
+        if (s.starts_with("$PSTMNMEAREQUEST,")) {
+            pending_.clear();
+            unsigned long mask = std::strtoul(s.c_str() + 17, nullptr, 16); // the message list is hexadecimal
+            for (const auto& sentence : sentences_) {
+                if (mask & sentence.first) {
+                    pending_.append(acquiring_ && sentence.first == 0x2 ? no_fix_ : sentence.second);
+                }
+            }
+            if (mask & 0x80000) {
+                for (const auto& gsv : constellation_gsv_) {
+                    if (constellations_ & gsv.first) {
+                        pending_.append(gsv.second);
+                    }
+                }
+            }
+            if (mask & 0x800000) {
+                append_cpu();
+            }
+            if (acquiring_) {
+                acquiring_--;
+            }
+            // status line: the command without the separator
+            pending_.append(s, 0, s.length() - 2);
+            pending_.append("\r\n");
+        } else if (s.starts_with("$PSTMFORCESTANDBY,")) {
+            standbys_++;
+            acquiring_ = hot_start_requests_;
+        } else if (s.starts_with("$PSTMSETCONSTMASK,")) {
+            constellations_ = std::strtoul(s.c_str() + 18, nullptr, 10);
+        } else if (s.starts_with("$PSTMGPSRESTART")) {
+            pending_ = "$PSTMGPSRESTARTOK\r\n";
+        }
+    }
+
+    //! reader handler: return the reply to the last command, with faults injected
+    /*!
+      \param s std::string reference gets the reply. Empty when nothing is pending.
+    */
+    void read(std::string& s) {
+        s.swap(pending_);
+        pending_.clear();
+        if (s.empty()) {
+            return;
+        }
+        if (hit(rates_.stall)) {
+            counts_.stall++;
+            s.clear();
+            return;
+        }
+        if (hit(rates_.ff_flood)) {
+            counts_.ff_flood++;
+            s.assign(pick(s.length()) + 1, '\xff');
+            return;
+        }
+        if (hit(rates_.missing_status) && s.length() > 2) {
+            counts_.missing_status++;
+            std::size_t status = s.rfind("\r\n", s.length() - 3);
+            s.erase(status == std::string::npos ? 0 : status + 2);
+        }
+        if (hit(rates_.interleave)) {
+            counts_.interleave++;
+            std::size_t line = s.find("\r\n");
+            if (line != std::string::npos) {
+                s.insert(line + 2, unsolicited_);
+            }
+        }
+        if (hit(rates_.truncate) && s.length() > 1) {
+            counts_.truncate++;
+            s.erase(pick(s.length() - 1) + 1);
+        }
+        if (hit(rates_.bit_flip) && !s.empty()) {
+            counts_.bit_flip++;
+            s[pick(s.length())] ^= static_cast<char>(1 << pick(8));
+        }
+    }
+
+    //! resetter handler: forget the pending reply. Doesn't wait the 4 s that the real Teseo needs.
+    void reset() {
+        pending_.clear();
+    }
+
+private:
+
+    bool hit(double rate) {
+        return rate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random_) < rate;
+    }
+
+    std::size_t pick(std::size_t range) {
+        return std::uniform_int_distribution<std::size_t>(0, range - 1)(random_);
+    }
+
+    //! $PSTMCPU: each tracked constellation costs the Teseo CPU time
+    void append_cpu() {
+        unsigned int load = 20;
+        for (unsigned int bits = constellations_; bits; bits &= bits - 1) {
+            load += 12;
+        }
+        char body[40];
+        int length = std::snprintf(body, sizeof(body), "PSTMCPU,%u.00,-1,98", load);
+        unsigned char checksum = 0;
+        for (int i = 0; i < length; i++) {
+            checksum ^= static_cast<unsigned char>(body[i]);
+        }
+        char line[48];
+        std::snprintf(line, sizeof(line), "$%s*%02X\r\n", body, checksum);
+        pending_.append(line);
+    }
+
+    fault_rates rates_;
+    fault_counts counts_;
+    std::minstd_rand random_;
+    //! the reply for the next read()
+    std::string pending_;
+    unsigned int hot_start_requests_;
+    //! requests left before the fix is back
+    unsigned int acquiring_;
+    unsigned long standbys_;
+    unsigned int constellations_;
+
+    //! canned sentences, with the $PSTMNMEAREQUEST message list bit that selects them
+    static inline const std::array<std::pair<unsigned long, std::string_view>, 8> sentences_ {{
+        {0x2, "$GPGGA,123519.000,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*59\r\n"},
+        {0x4, "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39\r\n"},
+        {0x10, "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48\r\n"},
+        {0x40, "$GPRMC,123519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*74\r\n"},
+        {0x80000, "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74\r\n"},
+        {0x80000, "$GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00*74\r\n"},
+        {0x80000, "$GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,*4D\r\n"},
+        {0x100000, "$GPGLL,4807.038,N,01131.000,E,123519.000,A,A*56\r\n"}
+    }};
+
+    //! GSV lines of the other constellations, with the $PSTMSETCONSTMASK bit that enables them
+    static inline const std::array<std::pair<unsigned int, std::string_view>, 3> constellation_gsv_ {{
+        {0x2, "$GLGSV,1,1,03,65,48,034,38,72,22,300,31,88,61,112,40*50\r\n"},
+        {0x8, "$GAGSV,1,1,02,11,55,090,41,36,18,225,33*6F\r\n"},
+        {0x80, "$BDGSV,1,1,02,06,40,180,35,14,66,045,42*65\r\n"}
+    }};
+
+    //! GGA while there is no fix
+    static constexpr std::string_view no_fix_ = "$GPGGA,123519.000,,,,,0,00,99.0,,M,,M,,*6B\r\n";
+
+    //! what the Teseo streams when the message list isn't empty
+    static constexpr std::string_view unsolicited_ = "$GPZDA,123519.000,23,03,1994,00,00*5C\r\n";
+};
+
+} // namespace teseo
+
+#endif // SIMULATOR_H_
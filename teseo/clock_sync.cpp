@@ -0,0 +1,187 @@
+#include "clock_sync.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace teseo {
+
+bool clock_sync::add(int64_t host_us, int64_t gnss_us) {
+    if (!replies_.add(host_us, gnss_us, rejection_sigma_)) {
+        return false;
+    }
+    last_gnss_us_ = gnss_us;
+    last_host_us_ = std::max(last_host_us_, host_us);
+    measure_latency(host_us);
+    return true;
+}
+
+bool clock_sync::add(int64_t host_us, std::string_view sentence) {
+    uint32_t ms; // intentionally uninitialised
+    if (!utc_of_day(sentence, ms)) {
+        return false;
+    }
+    int64_t gnss_us = static_cast<int64_t>(ms) * 1000;
+    if (last_gnss_us_ >= 0) { // continue on the day of the previous sample
+        gnss_us += last_gnss_us_ - last_gnss_us_ % day_us_;
+        if (gnss_us < last_gnss_us_ - day_us_ / 2) {
+            gnss_us += day_us_; // passed midnight
+        }
+    }
+    return add(host_us, gnss_us);
+}
+
+bool clock_sync::add_pps(int64_t host_us) {
+    if (!valid()) {
+        return false;
+    }
+    int64_t gnss_us = to_gnss(host_us);
+    int64_t second = (gnss_us + 500000) / 1000000 * 1000000;
+    if (!pps_.add(host_us, second, rejection_sigma_)) {
+        return false;
+    }
+    last_pps_us_ = host_us;
+    last_host_us_ = std::max(last_host_us_, host_us);
+    measure_latency(host_us);
+    return true;
+}
+
+void clock_sync::measure_latency(int64_t host_us) {
+    if (!replies_.valid() || !pps_.valid()) {
+        return;
+    }
+    const double latency = static_cast<double>(pps_.to_gnss(host_us) - replies_.to_gnss(host_us));
+    if (measured_ && std::fabs(latency - latency_us_) > max_latency_step_us_) {
+        // after a host clock jump, the edges were paired with the old model. Pair them again
+        pps_.reset();
+        measured_ = false;
+        return;
+    }
+    latency_us_ = latency;
+    measured_ = true;
+}
+
+bool clock_sync::utc_of_day(std::string_view sentence, uint32_t& ms) {
+    if (sentence.length() < 7) {
+        return false;
+    }
+    const std::string_view type = sentence.substr(3, 3);
+    unsigned int field; // intentionally uninitialised
+    if (type == "GGA" || type == "RMC") {
+        field = 1;
+    } else if (type == "GLL") {
+        field = 5;
+    } else {
+        return false;
+    }
+    std::size_t index = 0;
+    for (unsigned int i = 0; i < field && index != std::string_view::npos; i++) {
+        index = sentence.find(',', index + (i ? 1 : 0));
+    }
+    if (index == std::string_view::npos || sentence.length() < index + 7) {
+        return false;
+    }
+    const std::string_view time = sentence.substr(index + 1);
+    for (std::size_t i = 0; i < 6; i++) {
+        if (time[i] < '0' || time[i] > '9') {
+            return false;
+        }
+    }
+    auto two_digits = [&time](std::size_t i) -> uint32_t { return (time[i] - '0') * 10 + (time[i + 1] - '0'); };
+    ms = ((two_digits(0) * 60 + two_digits(2)) * 60 + two_digits(4)) * 1000;
+    if (time.length() > 6 && time[6] == '.') { // fraction, up to ms
+        uint32_t scale = 100;
+        for (std::size_t i = 7; i < time.length() && scale && time[i] >= '0' && time[i] <= '9'; i++, scale /= 10) {
+            ms += (time[i] - '0') * scale;
+        }
+    }
+    return true;
+}
+
+bool clock_sync::model::add(int64_t host_us, int64_t gnss_us, double rejection_sigma) {
+    if (valid()) {
+        double residual = static_cast<double>(gnss_us - to_gnss(host_us));
+        if (std::fabs(residual) > rejection_sigma * std::max(sigma_us, min_tolerance_us_)) {
+            rejected++;
+            if (rejected < window_ / 2) {
+                return false;
+            }
+            // the model doesn't describe the clocks anymore (e.g.: host clock jump). Start over
+            reset();
+        }
+    }
+    rejected = 0;
+    samples[head] = {host_us, gnss_us};
+    head = (head + 1) % window_;
+    if (count < window_) {
+        count++;
+    }
+    fit(rejection_sigma);
+    return true;
+}
+
+void clock_sync::model::fit(double rejection_sigma) {
+    fit_within(std::numeric_limits<double>::infinity());
+    if (count >= min_samples_) {
+        // second pass without the samples that the first pass shows as outliers
+        fit_within(rejection_sigma * std::max(sigma_us, min_tolerance_us_));
+    }
+}
+
+void clock_sync::model::reset() {
+    count = 0;
+    head = 0;
+    rejected = 0;
+    reference_us = 0;
+    offset_us = 0.0;
+    skew = 0.0;
+    sigma_us = 0.0;
+}
+
+void clock_sync::model::fit_within(double limit_us) {
+    // x: host time relative to the mean host time. y: gnss - host
+    // the inliers are selected with the previous model, once. The sums and sigma all use that set
+    std::array<bool, window_> inlier;
+    for (std::size_t i = 0; i < count; i++) {
+        inlier[i] = std::fabs(static_cast<double>(samples[i].gnss_us - to_gnss(samples[i].host_us))) <= limit_us;
+    }
+    std::size_t used = 0;
+    int64_t origin = samples[0].host_us;
+    double sum_x = 0.0;
+    double sum_y = 0.0;
+    for (std::size_t i = 0; i < count; i++) {
+        if (inlier[i]) {
+            sum_x += static_cast<double>(samples[i].host_us - origin);
+            sum_y += static_cast<double>(samples[i].gnss_us - samples[i].host_us);
+            used++;
+        }
+    }
+    if (used == 0) {
+        return;
+    }
+    double sxx = 0.0;
+    double sxy = 0.0;
+    int64_t reference = origin + static_cast<int64_t>(sum_x / static_cast<double>(used));
+    double mean_y = sum_y / static_cast<double>(used);
+    for (std::size_t i = 0; i < count; i++) {
+        if (inlier[i]) {
+            double x = static_cast<double>(samples[i].host_us - reference);
+            double y = static_cast<double>(samples[i].gnss_us - samples[i].host_us) - mean_y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+    }
+    reference_us = reference;
+    offset_us = mean_y;
+    skew = sxx > 0.0 ? sxy / sxx : 0.0;
+
+    double sum_r2 = 0.0;
+    for (std::size_t i = 0; i < count; i++) {
+        if (inlier[i]) {
+            double residual = static_cast<double>(samples[i].gnss_us - to_gnss(samples[i].host_us));
+            sum_r2 += residual * residual;
+        }
+    }
+    sigma_us = used > 2 ? std::sqrt(sum_r2 / static_cast<double>(used - 2)) : 0.0;
+}
+
+} // namespace teseo
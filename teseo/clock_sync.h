@@ -0,0 +1,188 @@
+#ifndef CLOCK_SYNC_H_
+#define CLOCK_SYNC_H_
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+
+namespace teseo {
+
+//! Maps GNSS time to the host's monotonic clock, and back.
+/*!
+  Fits gnss = host + offset + skew * (host - reference) over the last samples, least squares.
+  New samples whose residual exceeds rejection_sigma standard deviations are rejected as outliers.
+  Each fit is repeated once without the samples that are outliers to the first pass.  
+  Reply samples and PPS edges are fitted separately. A reply arrives a bus latency after the time it reports, so the
+  reply fit is late by that latency. PPS edges don't have it. While PPS edges arrive, conversions use the PPS fit,
+  and the latency is measured as the difference between both fits. Without PPS, the reply fit is corrected by the
+  last measured latency, or by the expected latency passed to the constructor.  
+  Conversions are O(1). add() and add_pps() refit over their sample window, O(window).
+
+  Example code:
+  @code
+  teseo::clock_sync sync;
+  gps.clock().set([]() -> uint64_t { return time_us_64(); });
+  std::string gga;
+  if (gps.ask_gga(gga)) {
+    sync.add(gps.reply_time(), gga);
+  }
+  int64_t imu_gnss_us = sync.to_gnss(imu_sample_time_us);
+  @endcode
+*/
+class clock_sync {
+public:
+
+    //! constructor.
+    /*!
+      \param rejection_sigma double residual limit in standard deviations, for outlier rejection.
+      \param latency_us double expected bus latency of a reply, in µs. Used until PPS edges measure it.
+    */
+    clock_sync(double rejection_sigma = 3.0, double latency_us = 0.0) : replies_(), pps_(), rejection_sigma_(rejection_sigma),
+        last_gnss_us_(-1), last_host_us_(0), last_pps_us_(0), latency_us_(latency_us), measured_(false) {}
+
+    //! add a sample: the host time a reply arrived, and the GNSS time it reports
+    /*!
+      \param host_us int64_t host time, e.g.: teseo::reply_time().  
+      \param gnss_us int64_t GNSS time in µs. Has to be continuous (doesn't wrap).  
+      \returns bool true if the sample was accepted, false if rejected as outlier
+    */
+    bool add(int64_t host_us, int64_t gnss_us);
+
+    //! add a sample from a GGA, RMC or GLL sentence
+    /*!
+      \param host_us int64_t host time, e.g.: teseo::reply_time().  
+      \param sentence std::string_view the sentence. Its UTC time of day is unwrapped across midnight.  
+      \returns bool true if the sentence has a time and the sample was accepted
+    */
+    bool add(int64_t host_us, std::string_view sentence);
+
+    //! add a PPS edge
+    /*!
+      \param host_us int64_t host time of the PPS edge.  
+      \returns bool true if accepted. Needs a model first: the edge is paired with the nearest whole GNSS second.
+      The bus latency has to be below 0.5 s, or known from the constructor, to pair the first edges right.
+    */
+    bool add_pps(int64_t host_us);
+
+    //! convert host time to GNSS time. Without samples, GNSS time is host time
+    inline int64_t to_gnss(int64_t host_us) const {
+        return pps_active() ? pps_.to_gnss(host_us) : replies_.to_gnss(host_us) + static_cast<int64_t>(latency_us_);
+    }
+
+    //! convert GNSS time to host time
+    inline int64_t to_host(int64_t gnss_us) const {
+        return pps_active() ? pps_.to_host(gnss_us) : replies_.to_host(gnss_us - static_cast<int64_t>(latency_us_));
+    }
+
+    //! uncertainty of a conversion, in µs
+    /*!
+      The standard deviation of the residuals of the fit in use. Without PPS, and before a latency was measured,
+      the expected latency is added: the reply fit is off by the error of that guess, up to the whole latency.
+    */
+    inline double uncertainty_us() const {
+        if (pps_active()) {
+            return pps_.sigma_us;
+        }
+        return measured_ ? replies_.sigma_us : std::sqrt(replies_.sigma_us * replies_.sigma_us + latency_us_ * latency_us_);
+    }
+
+    //! bus latency of a reply, in µs. Measured while PPS edges arrive, else the expected latency
+    inline double latency_us() const {
+        return latency_us_;
+    }
+
+    //! host clock skew relative to GNSS, in parts per million
+    inline double skew_ppm() const {
+        return (pps_active() ? pps_.skew : replies_.skew) * 1e6;
+    }
+
+    //! true when there are enough samples for a fit
+    inline bool valid() const {
+        return replies_.valid() || pps_.valid();
+    }
+
+    //! parse the UTC time of day of a GGA, RMC or GLL sentence
+    /*!
+      \param sentence std::string_view the sentence.  
+      \param ms uint32_t reference gets milliseconds since midnight.  
+      \returns bool true if the sentence has a valid time field
+    */
+    static bool utc_of_day(std::string_view sentence, uint32_t& ms);
+
+private:
+
+    struct sample {
+        int64_t host_us;
+        int64_t gnss_us;
+    };
+
+    static constexpr std::size_t window_ = 32;
+    static constexpr std::size_t min_samples_ = 4;
+    static constexpr int64_t day_us_ = 86400LL * 1000000LL;
+    //! lower limit of the outlier threshold, when the fit is near perfect
+    static constexpr double min_tolerance_us_ = 1000.0;
+    //! the PPS fit is used while its last edge is this recent
+    static constexpr int64_t pps_timeout_us_ = 2000000;
+    //! a change of the measured latency beyond this means that the PPS edges were paired with the wrong second
+    static constexpr double max_latency_step_us_ = 500000.0;
+
+    //! least squares fit over a window of samples
+    struct model {
+        std::array<sample, window_> samples {};
+        std::size_t count = 0;
+        std::size_t head = 0;
+        //! consecutive rejected samples
+        std::size_t rejected = 0;
+        int64_t reference_us = 0;
+        double offset_us = 0.0;
+        double skew = 0.0;
+        double sigma_us = 0.0;
+
+        inline bool valid() const {
+            return count >= min_samples_;
+        }
+
+        inline int64_t to_gnss(int64_t host_us) const {
+            return host_us + static_cast<int64_t>(offset_us + skew * static_cast<double>(host_us - reference_us));
+        }
+
+        inline int64_t to_host(int64_t gnss_us) const {
+            // invert gnss = host + offset + skew * (host - reference)
+            return reference_us + static_cast<int64_t>((static_cast<double>(gnss_us - reference_us) - offset_us) / (1.0 + skew));
+        }
+
+        //! add a sample, unless it's an outlier. Starts over after window / 2 consecutive outliers
+        bool add(int64_t host_us, int64_t gnss_us, double rejection_sigma);
+        //! forget the samples and the fit
+        void reset();
+        //! refit over the sample window, rejecting outliers
+        void fit(double rejection_sigma);
+        //! one least squares pass, over the samples within limit_us of the current fit
+        void fit_within(double limit_us);
+    };
+
+    inline bool pps_active() const {
+        return pps_.valid() && last_pps_us_ >= last_host_us_ - pps_timeout_us_;
+    }
+
+    //! measure the latency as the difference between the reply and the PPS fit
+    void measure_latency(int64_t host_us);
+
+    model replies_;
+    model pps_;
+    double rejection_sigma_;
+    //! last GNSS time added, to unwrap time of day. -1: none yet
+    int64_t last_gnss_us_;
+    //! latest host time of a sample
+    int64_t last_host_us_;
+    //! host time of the last PPS edge
+    int64_t last_pps_us_;
+    double latency_us_;
+    //! latency_us_ is measured, not the expected value
+    bool measured_;
+};
+
+} // namespace teseo
+
+#endif // CLOCK_SYNC_H_
@@ -0,0 +1,103 @@
+#include "command_queue.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+
+namespace teseo {
+
+class command_queue::promised : public command_queue::request {
+public:
+    promised(std::function<bool(teseo&)> work) : request(std::move(work)), promise_() {}
+
+    std::future<bool> future() {
+        return promise_.get_future();
+    }
+
+protected:
+    void complete(teseo& gps) override {
+        try {
+            promise_.set_value(work_(gps));
+        } catch (...) {
+            promise_.set_exception(std::current_exception());
+        }
+        delete this;
+    }
+
+    void cancel() override {
+        delete this; // the promise is broken: the future gets a broken_promise error
+    }
+
+private:
+    std::promise<bool> promise_;
+};
+
+command_queue::~command_queue() {
+    while (request* r = pop()) {
+        r->cancel(); // r can be deleted or reused from here on
+    }
+}
+
+void command_queue::submit(request& r) {
+    push(&r);
+}
+
+std::future<bool> command_queue::submit(std::function<bool(teseo&)> work) {
+    promised* r = new promised(std::move(work));
+    std::future<bool> result = r->future();
+    push(r);
+    return result;
+}
+
+std::size_t command_queue::run(std::size_t max_batch) {
+    TESEO_TRACE_SCOPE("command queue: run");
+    std::size_t count = 0;
+    while (count < max_batch) {
+        request* r = pop();
+        if (r == nullptr) {
+            break;
+        }
+        r->complete(gps_); // r can be deleted or reused from here on
+        count++;
+    }
+    return count;
+}
+
+void command_queue::push(request* r) {
+    r->next_.store(nullptr, std::memory_order_relaxed);
+    request* previous = head_.exchange(r, std::memory_order_acq_rel);
+    // between the exchange and this store, the consumer sees a gap, and waits for the next run()
+    previous->next_.store(r, std::memory_order_release);
+}
+
+command_queue::request* command_queue::pop() {
+    request* tail = tail_;
+    request* next = tail->next_.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+        if (next == nullptr) {
+            return nullptr; // empty
+        }
+        tail_ = next;
+        tail = next;
+        next = next->next_.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+        tail_ = next;
+        return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+        return nullptr; // a producer is linking a request after this one
+    }
+    // tail is the last request. Put the stub behind it, so that it can be unlinked
+    push(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next != nullptr) {
+        tail_ = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+} // namespace teseo
@@ -0,0 +1,146 @@
+#ifndef COMMAND_QUEUE_H_
+#define COMMAND_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include "teseo.h"
+
+namespace teseo {
+
+//! Lock-free submission of commands from many threads, to one I/O thread.
+/*!
+  The teseo object isn't thread safe, and a poll blocks in the reader handler. Instead of a mutex around it,
+  threads submit requests to this queue. One thread owns the teseo object, and calls run() to execute the pending
+  requests in submission order, in a batch.  
+  submit() costs one atomic exchange and one atomic store. It never blocks and never waits for the I/O thread.
+  Intrusive multi producer, single consumer queue (D. Vyukov): the request objects are the queue nodes.
+
+  A request holds the work, a function that gets the teseo object and returns the result of the ask_*() call,
+  and an optional completion callback that gets that result. The completion runs on the I/O thread.
+  It can wake a waiting thread, or resume a coroutine. submit(std::function<bool(teseo&)>) returns a std::future instead.
+  Data that the work fills in (e.g.: the reply string) is captured by reference, and owned by the submitter.  
+  An exception from the work is caught: the future gets it, the completion callback gets false.
+  Requests that are still queued when the queue is destroyed are not executed: their future gets a broken_promise
+  error, their completion callback gets false. Submitting while the queue is destroyed is not allowed.
+
+  Example code:
+  @code
+  teseo::command_queue queue(gps);
+  // I/O thread
+  while (running) {
+    queue.run();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  // other threads
+  std::string gga;
+  std::future<bool> valid = queue.submit([&gga](teseo::teseo& gps) -> bool { return gps.ask_gga(gga); });
+  if (valid.get()) { ... }
+  @endcode
+*/
+class command_queue {
+public:
+
+    //! a queued command
+    /*!
+      Owned by the submitter. It has to stay alive until its completion has run, and can be reused after that.
+    */
+    class request {
+    public:
+        //! constructor.
+        /*!
+          \param work function that gets the teseo object, and returns the result of the command.
+          \param done function that gets the result. Optional.
+        */
+        request(std::function<bool(teseo&)> work, std::function<void(bool)> done = nullptr) :
+            work_(std::move(work)), done_(std::move(done)), next_(nullptr) {}
+
+        virtual ~request() = default;
+
+    protected:
+        //! run the work, and report the result
+        virtual void complete(teseo& gps) {
+            bool result = false;
+            try {
+                result = work_(gps);
+            } catch (...) {
+                // no way to hand the exception to the completion. It gets false, as for an invalid reply
+            }
+            if (done_) {
+                done_(result);
+            }
+        }
+
+        //! the queue is destroyed before the work ran. Report false
+        virtual void cancel() {
+            if (done_) {
+                done_(false);
+            }
+        }
+
+        std::function<bool(teseo&)> work_;
+
+    private:
+        friend class command_queue;
+        std::function<void(bool)> done_;
+        std::atomic<request*> next_;
+    };
+
+    //! constructor.
+    /*!
+      \param gps teseo reference. Only run() uses it.
+    */
+    command_queue(teseo& gps) : gps_(gps), stub_([](teseo&) -> bool { return false; }), head_(&stub_), tail_(&stub_) {}
+
+    command_queue(const command_queue&) = delete;
+    command_queue& operator=(const command_queue&) = delete;
+
+    //! cancel the requests that are still queued. See the class documentation
+    ~command_queue();
+
+    //! queue a request. Any thread
+    void submit(request& r);
+
+    //! queue a command, and get a future for its result. Any thread
+    /*!
+      \param work function that gets the teseo object, and returns the result of the command.
+      \returns std::future<bool> ready when the I/O thread executed the command
+
+      Allocates the request. Use submit(request&) to avoid that.
+    */
+    std::future<bool> submit(std::function<bool(teseo&)> work);
+
+    //! execute pending requests. I/O thread only
+    /*!
+      \param max_batch std::size_t most requests to execute in this call.
+      \returns std::size_t the number of requests executed
+
+      Requests whose submission is still in progress in another thread are left for the next call.
+    */
+    std::size_t run(std::size_t max_batch = SIZE_MAX);
+
+private:
+
+    //! a request with a promise, deleted when complete
+    class promised;
+
+    //! link a request at the head
+    void push(request* r);
+
+    //! unlink the request at the tail. nullptr if none is complete
+    request* pop();
+
+    teseo& gps_;
+    //! placeholder node, so that the queue is never empty
+    request stub_;
+    //! producers link here
+    alignas(64) std::atomic<request*> head_;
+    //! the consumer unlinks here
+    alignas(64) request* tail_;
+};
+
+} // namespace teseo
+
+#endif // COMMAND_QUEUE_H_
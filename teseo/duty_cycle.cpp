@@ -0,0 +1,64 @@
+#include "duty_cycle.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+
+namespace teseo {
+
+bool duty_cycle::tick(uint64_t now_ms, std::string& gga) {
+    switch (state_) {
+    case state::start:
+        wake_at_ = now_ms;
+        next_fix_at_ = now_ms;
+        state_ = state::acquiring;
+        break;
+    case state::standby:
+        if (now_ms + wake_lead_ms_ < next_fix_at_) {
+            return false;
+        }
+        // the Teseo woke up by itself
+        TESEO_TRACE_INSTANT("duty cycle: wake");
+        wake_at_ = now_ms;
+        state_ = state::acquiring;
+        break;
+    case state::acquiring:
+        break;
+    }
+
+    static const nmea_filter has_fix {.min_quality = 1};
+    if (gps_.ask_gga(gga) && gga.length() >= 7 && has_fix.accept(gga)) {
+        report_.fixes++;
+        report_.wake_to_fix_ms = static_cast<uint32_t>(now_ms - wake_at_);
+        sleep(now_ms);
+        return true;
+    }
+    if (now_ms - wake_at_ >= fix_timeout_ms_) {
+        TESEO_TRACE_INSTANT("duty cycle: no fix");
+        report_.misses++;
+        sleep(now_ms);
+    }
+    return false;
+}
+
+void duty_cycle::sleep(uint64_t now_ms) {
+    report_.on_time_ms = static_cast<uint32_t>(now_ms - wake_at_);
+    report_.total_on_time_ms += report_.on_time_ms;
+
+    next_fix_at_ += period_ms_;
+    if (next_fix_at_ <= now_ms) { // overran. Skip the missed periods
+        next_fix_at_ = now_ms + period_ms_;
+    }
+    state_ = state::standby;
+
+    // the Teseo counts in seconds. Round down, so that it's awake before the controller polls
+    uint64_t standby_ms = next_fix_at_ - now_ms > wake_lead_ms_ ? next_fix_at_ - now_ms - wake_lead_ms_ : 0;
+    if (standby_ms >= 1000) {
+        TESEO_TRACE_INSTANT("duty cycle: standby");
+        gps_.standby(static_cast<unsigned int>(standby_ms / 1000));
+    }
+}
+
+} // namespace teseo
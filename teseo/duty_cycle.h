@@ -0,0 +1,95 @@
+#ifndef DUTY_CYCLE_H_
+#define DUTY_CYCLE_H_
+
+#include <string>
+#include <cstdint>
+#include "teseo.h"
+
+namespace teseo {
+
+//! Duty cycle controller, for battery powered trackers.
+/*!
+  Takes one fix per period, and keeps the Teseo in standby in between.  
+  The Teseo is put in standby with teseo::standby(). It wakes up by itself, wake_lead_ms before the next fix is due,
+  and hot starts. The controller then polls GGA until the fix quality is valid, or until fix_timeout_ms expires.
+  Then the Teseo goes back to standby. No reset, no initialize().  
+
+  tick() doesn't sleep or wait for the fix. The developer calls it from the main loop, with the current time in ms.
+  In standby, it only compares times. While acquiring, each call polls GGA once with teseo::ask_gga(). That
+  blocks for one command round trip, as long as the reader handler takes to return the reply.
+
+  Example code:
+  @code
+  teseo::duty_cycle cycle(gps, 60000, 2000, 30000); // a fix each minute
+  std::string gga;
+  while (true) {
+    if (cycle.tick(to_ms_since_boot(get_absolute_time()), gga)) {
+      // use gga
+    }
+    sleep_ms(100);
+  }
+  @endcode
+*/
+class duty_cycle {
+public:
+
+    //! duty cycle statistics
+    struct report {
+        //! periods that delivered a fix
+        unsigned long fixes = 0;
+        //! periods that timed out without fix
+        unsigned long misses = 0;
+        //! wake-up to valid fix, of the last fix
+        uint32_t wake_to_fix_ms = 0;
+        //! time the Teseo was awake for the last period
+        uint32_t on_time_ms = 0;
+        //! accumulated awake time
+        uint64_t total_on_time_ms = 0;
+    };
+
+    //! constructor.
+    /*!
+      \param gps teseo reference. Handlers have to be set, the Teseo configured.  
+      \param period_ms uint32_t time between fixes.  
+      \param wake_lead_ms uint32_t wake up this much before the fix is due, to allow the hot start.  
+      \param fix_timeout_ms uint32_t give up on a fix after this time awake.
+    */
+    duty_cycle(teseo& gps, uint32_t period_ms, uint32_t wake_lead_ms, uint32_t fix_timeout_ms) :
+        gps_(gps), period_ms_(period_ms), wake_lead_ms_(wake_lead_ms), fix_timeout_ms_(fix_timeout_ms),
+        state_(state::start), wake_at_(0), next_fix_at_(0), report_() {}
+
+    //! advance the controller
+    /*!
+      \param now_ms uint64_t current time, monotonic.  
+      \param gga std::string reference gets the GGA sentence when a fix is taken.  
+      \returns bool true if a fix was taken in this tick
+    */
+    bool tick(uint64_t now_ms, std::string& gga);
+
+    //! expose the statistics
+    inline const report& statistics() const {
+        return report_;
+    }
+
+private:
+
+    enum class state { start, standby, acquiring };
+
+    //! schedule the next fix and put the Teseo in standby until just before it
+    void sleep(uint64_t now_ms);
+
+    teseo& gps_;
+    uint32_t period_ms_;
+    uint32_t wake_lead_ms_;
+    uint32_t fix_timeout_ms_;
+    state state_;
+    //! when the current period woke up
+    uint64_t wake_at_;
+    //! when the next fix is due
+    uint64_t next_fix_at_;
+    report report_;
+};
+
+} // namespace teseo
+
+#endif // DUTY_CYCLE_H_
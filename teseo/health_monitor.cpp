@@ -0,0 +1,86 @@
+#include "health_monitor.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+
+namespace teseo {
+
+health_monitor::level health_monitor::tick(uint64_t now_ms) {
+    if (healthy(now_ms)) {
+        level_ = level::healthy;
+        return level_;
+    }
+
+    switch (level_) {
+    case level::healthy:
+        level_ = level::resync;
+        escalated_at_ = now_ms;
+        window_ = seen_;
+        TESEO_TRACE_INSTANT("health: resync");
+        resync_.call();
+        break;
+    case level::resync:
+        if (now_ms - escalated_at_ >= limits_.escalation_ms) {
+            level_ = level::reset;
+            escalated_at_ = now_ms;
+            window_ = seen_;
+            TESEO_TRACE_INSTANT("health: reset");
+            reset_.call();
+        }
+        break;
+    case level::reset:
+        if (now_ms - escalated_at_ >= limits_.escalation_ms) {
+            level_ = level::failed;
+            escalated_at_ = now_ms;
+            TESEO_TRACE_INSTANT("health: failed");
+            failed_.call();
+        }
+        break;
+    case level::failed:
+        break;
+    }
+    return level_;
+}
+
+bool health_monitor::healthy(uint64_t now_ms) {
+    const counters& now = gps_.statistics();
+    if (!started_) { // the timeouts count from the first tick
+        started_ = true;
+        last_reply_at_ = now_ms;
+        last_fix_at_ = now_ms;
+        seen_ = now;
+        window_ = now;
+    }
+
+    if (now.valid_replies != seen_.valid_replies) {
+        last_reply_at_ = now_ms;
+    }
+    if (now.fixes != seen_.fixes) {
+        last_fix_at_ = now_ms;
+    }
+    seen_ = now;
+
+    unsigned long requests = now.requests - window_.requests;
+    if (requests >= limits_.window_requests) {
+        window_unhealthy_ = !window_healthy(now, requests);
+        window_ = now;
+    } else if (window_unhealthy_ && requests && requests * 2 >= limits_.window_requests) {
+        // recovery: half a window within the limits
+        window_unhealthy_ = !window_healthy(now, requests);
+    }
+
+    bool reply_stale = now_ms - last_reply_at_ > limits_.reply_timeout_ms;
+    bool fix_stale = limits_.fix_timeout_ms && now_ms - last_fix_at_ > limits_.fix_timeout_ms;
+    return !(reply_stale || fix_stale || window_unhealthy_);
+}
+
+bool health_monitor::window_healthy(const counters& now, unsigned long requests) const {
+    unsigned long invalid = now.invalid_replies - window_.invalid_replies;
+    unsigned long status = now.status_failures - window_.status_failures;
+    return invalid * 100 <= requests * limits_.failure_percent && status < limits_.status_failures;
+}
+
+} // namespace teseo
@@ -0,0 +1,124 @@
+#ifndef HEALTH_MONITOR_H_
+#define HEALTH_MONITOR_H_
+
+#include <cstdint>
+#include "callbackmanager.h"
+#include "teseo.h"
+
+namespace teseo {
+
+//! health_monitor thresholds
+struct health_limits {
+    //! longest time without a valid reply
+    uint32_t reply_timeout_ms = 5000;
+    //! longest time without a fix. 0: not checked
+    uint32_t fix_timeout_ms = 0;
+    //! highest percentage of invalid replies in a window
+    unsigned int failure_percent = 50;
+    //! highest number of replies without status line in a window
+    unsigned long status_failures = 3;
+    //! requests per window
+    unsigned long window_requests = 10;
+    //! time to wait for a recovery action to work, before escalating
+    uint32_t escalation_ms = 10000;
+};
+
+//! Receiver health monitor.
+/*!
+  Watches the teseo health counters, and escalates when the receiver looks hung:  
+  - no valid reply for reply_timeout_ms  
+  - validation failure rate above failure_percent, over a window of window_requests requests  
+  - status_failures replies without status line in that window  
+  - no fix for fix_timeout_ms (optional)  
+
+  The first problem triggers the resync() callback. If the receiver is still unhealthy escalation_ms later, reset(),
+  and again escalation_ms later, failed(). A healthy tick returns to level::healthy.  
+  Each escalation starts a new window, so that it only counts the requests after the recovery action.
+  After an unhealthy window, half a window within the limits clears the verdict, without waiting for the full window.  
+  tick() only reads counters. It never talks to the Teseo. The callbacks decide how and when to recover,
+  e.g.: flag the main loop to call teseo::resync(). Call tick() from the thread that polls.
+
+  Example code:
+  @code
+  teseo::health_monitor monitor(gps);
+  bool resync_needed = false;
+  monitor.resync().set([&resync_needed]() -> void { resync_needed = true; });
+  // main loop
+  monitor.tick(to_ms_since_boot(get_absolute_time()));
+  if (resync_needed) {
+    resync_needed = false;
+    gps.resync();
+  }
+  @endcode
+*/
+class health_monitor {
+public:
+
+    //! escalation level
+    enum class level { healthy, resync, reset, failed };
+
+    //! constructor.
+    /*!
+      \param gps const teseo reference to watch.  
+      \param thresholds health_limits.
+    */
+    health_monitor(const teseo& gps, const health_limits& thresholds = health_limits()) :
+        gps_(gps), limits_(thresholds), level_(level::healthy), started_(false), last_reply_at_(0), last_fix_at_(0),
+        escalated_at_(0), seen_(), window_(), window_unhealthy_(false) {}
+
+    //! expose the callback manager for the first recovery action
+    inline Callback<void>& resync() {
+        return resync_;
+    }
+
+    //! expose the callback manager for the second recovery action
+    inline Callback<void>& reset() {
+        return reset_;
+    }
+
+    //! expose the callback manager for when recovery didn't work
+    inline Callback<void>& failed() {
+        return failed_;
+    }
+
+    //! check the counters, and escalate if needed
+    /*!
+      \param now_ms uint64_t current time, monotonic.  
+      \returns level the escalation level after this tick
+    */
+    level tick(uint64_t now_ms);
+
+    //! current escalation level
+    inline level state() const {
+        return level_;
+    }
+
+private:
+
+    //! evaluate the counters since the previous tick
+    bool healthy(uint64_t now_ms);
+
+    //! check the failure rate and status failures since the start of the window
+    bool window_healthy(const counters& now, unsigned long requests) const;
+
+    const teseo& gps_;
+    health_limits limits_;
+    level level_;
+    bool started_;
+    uint64_t last_reply_at_;
+    uint64_t last_fix_at_;
+    uint64_t escalated_at_;
+    //! counters at the previous tick
+    counters seen_;
+    //! counters at the start of the failure rate window
+    counters window_;
+    //! verdict of the last complete window
+    bool window_unhealthy_;
+    Callback<void> resync_;
+    Callback<void> reset_;
+    Callback<void> failed_;
+};
+
+} // namespace teseo
+
+#endif // HEALTH_MONITOR_H_
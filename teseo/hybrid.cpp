@@ -0,0 +1,167 @@
+#include "hybrid.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+#include <algorithm>
+#include "nmea.h"
+
+namespace teseo {
+
+namespace {
+
+//! GSV message number 1: the first line of a satellite group
+bool starts_group(std::string_view line) {
+    // $GPGSV,<total>,<number>,...
+    if (line.substr(3, 4) != "GSV,") {
+        return false;
+    }
+    std::size_t index = line.find(',', 7);
+    return index != std::string_view::npos && line.substr(index, 3) == ",1,";
+}
+
+} // namespace
+
+void hybrid::pump() {
+    TESEO_TRACE_SCOPE("hybrid: pump");
+    receive();
+    std::string_view line;
+    std::size_t consumed = 0;
+    while (next_line(line, consumed)) {
+        deliver(line);
+    }
+    pending_.erase(0, consumed);
+}
+
+bool hybrid::ask_nmea(const nmea_rr& command, std::span<std::string> strings, unsigned int& count,
+        const nmea_filter& filter) {
+    TESEO_TRACE_SCOPE("hybrid: poll");
+    const std::string_view status(command.first.data(), command.first.length() - 2);
+    std::string_view line;
+    std::size_t consumed = 0;
+    bool valid = false;
+    bool replied = false; // a line of the reply arrived
+    count = 0;
+
+    // lines that arrived before the request are streamed data
+    while (next_line(line, consumed)) {
+        deliver(line);
+    }
+    pending_.erase(0, consumed);
+
+    gps_.send(command);
+    for (unsigned int reads = 0; reads < max_poll_reads_ && !valid; reads++) {
+        receive();
+        consumed = 0;
+        while (!valid && next_line(line, consumed)) {
+            if (line.starts_with(status)) {
+                valid = true; // the lines after the status line stay pending, for pump()
+            } else if (matches_signature(line, command.second)) {
+                replied = true;
+                // the reply is the last one before the status line. A streamed line or group of the same type
+                // that came first is replaced
+                if (strings.size() == 1 || starts_group(line)) {
+                    count = 0;
+                }
+                if (count < strings.size() && filter.accept(line)) {
+                    strings[count].assign(line);
+                    count++;
+                }
+                deliver(line);
+            } else {
+                deliver(line); // streamed in the middle of the reply
+            }
+        }
+        pending_.erase(0, consumed);
+    }
+    std::for_each(strings.begin() + count, strings.end(),
+        [](auto &discard) { discard.clear(); });
+    if (valid) {
+        report_.replies++;
+    } else {
+        report_.incomplete++;
+    }
+    // not valid: the status line is missing. That is a status failure when the reply came without it, not when
+    // nothing came
+    if (valid) {
+        gps_.tally(true, true);
+    } else {
+        gps_.tally(false, !replied);
+    }
+    if (valid && strings.size() == 1 && count == 1) {
+        gps_.tally_fix(strings[0]);
+    }
+    return valid;
+}
+
+void hybrid::receive() {
+    gps_.read(received_);
+    pending_.append(received_);
+}
+
+bool hybrid::next_line(std::string_view& line, std::size_t& consumed) {
+    const std::string_view data(pending_);
+    while (true) {
+        std::size_t end = data.find("\r\n", consumed);
+        if (end == std::string_view::npos) {
+            if (data.length() - consumed > max_line_) {
+                report_.overruns++;
+                consumed = data.length();
+            }
+            return false;
+        }
+        line = data.substr(consumed, end + 2 - consumed);
+        consumed = end + 2;
+        // skip bus noise (e.g.: 0xFF from an idle I2C bus) in front of the sentence
+        std::size_t start = line.find('$');
+        if (start != std::string_view::npos && line.length() - start >= 9) {
+            line.remove_prefix(start);
+            report_.lines++;
+            return true;
+        }
+    }
+}
+
+void hybrid::deliver(std::string_view line) {
+    if (!filter_.accept(line)) {
+        return;
+    }
+    if (duplicate(line)) {
+        report_.duplicates++;
+        return;
+    }
+    report_.delivered++;
+    subscriber_.call(line);
+}
+
+bool hybrid::duplicate(std::string_view line) {
+    const std::string_view type = line.substr(3, 3);
+    uint32_t utc_ms = 0;
+    if (type == "GGA") {
+        nmea::gga fix;
+        utc_ms = nmea::decode(line, fix) ? fix.utc_ms : 0;
+    } else if (type == "RMC") {
+        nmea::rmc fix;
+        utc_ms = nmea::decode(line, fix) ? fix.utc_ms : 0;
+    } else if (type == "GLL") {
+        nmea::gll fix;
+        utc_ms = nmea::decode(line, fix) ? fix.utc_ms : 0;
+    }
+    if (utc_ms == 0) {
+        return false; // no time: not a type with one, no time yet (before the first fix), or midnight
+    }
+
+    const std::array<char, 3> key {type[0], type[1], type[2]};
+    for (const auto& seen : recent_) {
+        if (seen.utc_ms == utc_ms && seen.type == key) {
+            return true;
+        }
+    }
+    recent_[recent_next_] = {key, utc_ms};
+    recent_next_ = (recent_next_ + 1) % max_recent_;
+    return false;
+}
+
+} // namespace teseo
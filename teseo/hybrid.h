@@ -0,0 +1,167 @@
+#ifndef HYBRID_H_
+#define HYBRID_H_
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <span>
+#include <cstdint>
+#include "callbackmanager.h"
+#include "teseo.h"
+
+namespace teseo {
+
+//! Mixed streaming and polling on one link.
+/*!
+  For a Teseo that streams sentences (its message list isn't empty) and is also polled with $PSTMNMEAREQUEST.
+  A framer splits everything that the reader handler returns into lines. Streamed lines go to the subscriber.
+  A poll lifts its reply out of the stream: the lines with the requested signature, up to the status line.
+  Streamed lines that arrive in the middle of the reply are routed to the subscriber, and don't break validation.
+  Each sentence is handed to the subscriber once: a line with the same sentence type and UTC time as an earlier one
+  (e.g.: a GGA that was streamed, and also returned by a poll) is a duplicate, and isn't handed again.
+  The UTC time is decoded with nmea::decode(), for GGA, RMC and GLL. Other sentences (GSV, GSA, VTG, ...) are not
+  de-duplicated, nor are sentences that fail their checksum or have no time yet.
+
+  Call pump() from the main loop to process the stream, and ask<>() to poll. Both from the same thread.
+  The teseo object is used for its writer and reader. Polls update its health counters (teseo::statistics()), so that
+  a health_monitor sees them. Streamed lines don't: the hybrid keeps its own statistics for those.
+
+  Example code:
+  @code
+  teseo::hybrid link(gps);
+  static constexpr std::array<std::string_view, 2> position {"GGA", "RMC"};
+  link.filter({.sentences = position});
+  link.subscriber().set([](std::string_view line) -> void { store(line); });
+  // loop
+  link.pump();
+  if (satellites_due) {
+    link.ask<teseo::sentence::gsv>(strings, count);
+  }
+  @endcode
+*/
+class hybrid {
+public:
+
+    //! hybrid link statistics
+    struct report {
+        //! complete lines framed
+        unsigned long lines = 0;
+        //! lines handed to the subscriber
+        unsigned long delivered = 0;
+        //! lines not handed again, because of an equal sentence type and UTC time
+        unsigned long duplicates = 0;
+        //! polls that found their status line
+        unsigned long replies = 0;
+        //! polls that gave up without status line
+        unsigned long incomplete = 0;
+        //! lines discarded because they didn't end within max_line_
+        unsigned long overruns = 0;
+    };
+
+    //! constructor.
+    /*!
+      \param gps teseo reference. The writer and reader handlers have to be set.
+    */
+    hybrid(teseo& gps) : gps_(gps), filter_(), received_(), pending_(), recent_(), recent_next_(0), report_() {}
+
+    //! expose the callback manager for the subscriber
+    /*!
+      Callback parameter: std::string_view with one sentence, "\r\n" included. Only valid during the call.
+      For instructions on how to register your handler, check the documentation of teseo::writer().
+    */
+    inline Callback<void, std::string_view>& subscriber() {
+        return subscriber_;
+    }
+
+    //! select the sentences that the subscriber gets. The filter's sets are not copied, and have to outlive the hybrid.
+    inline void filter(const nmea_filter& filter) {
+        filter_ = filter;
+    }
+
+    //! expose the statistics
+    inline const report& statistics() const {
+        return report_;
+    }
+
+    //! read once, and hand the complete lines to the subscriber
+    void pump();
+
+    //! poll the Teseo, while the stream goes on
+    /*!
+      \param command const nmea_rr reference holds the NMEA command.
+      \param strings std::span<std::string> gets the reply lines.
+      \param count unsigned int reference gets count of reply lines.
+      \param filter nmea_filter const reference selects the reply lines to return. Default: all.
+      \returns bool true if the status line arrived within max_poll_reads_ reads
+
+      Lines without the command's signature are streamed data, and go to the subscriber.
+      Reply lines go to the subscriber too, unless they are duplicates.
+      The reply is the last one with the command's signature before the status line: a line of the same type that
+      was streamed before it is replaced. For a single line, the last line. For GSV, the group that starts at the
+      last message number 1. Other multi line replies take all lines with the signature.
+    */
+    bool ask_nmea(const nmea_rr& command, std::span<std::string> strings, unsigned int& count,
+            const nmea_filter& filter = nmea_filter());
+
+    //! poll a single line sentence. See ask_nmea()
+    template <typename S> requires (!S::multi_line)
+    bool ask(std::string& s) {
+        unsigned int count;
+        bool valid = ask_nmea(teseo::command<S>, std::span<std::string>(&s, 1), count);
+        return valid && count == 1;
+    }
+
+    //! poll a multi line sentence. See ask_nmea()
+    template <typename S> requires (S::multi_line)
+    bool ask(std::span<std::string> strings, unsigned int& count, const nmea_filter& filter = nmea_filter()) {
+        return ask_nmea(teseo::command<S>, strings, count, filter);
+    }
+
+private:
+
+    //! sentence type and UTC time of a delivered line
+    struct stamp {
+        std::array<char, 3> type;
+        //! ms since midnight. UINT32_MAX: unused slot
+        uint32_t utc_ms = UINT32_MAX;
+    };
+
+    //! read once, and append to the pending data
+    void receive();
+
+    //! take the next complete line from the pending data
+    /*!
+      \param line std::string_view reference gets the line, "\r\n" included. It points into pending_.
+      \param consumed std::size_t reference is advanced past the line.
+      \returns bool true if there is a complete line
+    */
+    bool next_line(std::string_view& line, std::size_t& consumed);
+
+    //! hand a line to the subscriber, unless it's filtered out or a duplicate
+    void deliver(std::string_view line);
+
+    //! check the line against the recently delivered ones, and remember it
+    bool duplicate(std::string_view line);
+
+    //! upper limit of reads for a poll, when the status line doesn't come
+    static constexpr unsigned int max_poll_reads_ = 8;
+    //! longest line. Longer data is discarded up to the next "\r\n"
+    static constexpr std::size_t max_line_ = 128;
+    //! delivered lines remembered for de-duplication
+    static constexpr std::size_t max_recent_ = 8;
+
+    teseo& gps_;
+    nmea_filter filter_;
+    Callback<void, std::string_view> subscriber_;
+    //! receive buffer for the reader handler. Reused
+    std::string received_;
+    //! data not yet framed: a partial line, kept between reads
+    std::string pending_;
+    std::array<stamp, max_recent_> recent_;
+    std::size_t recent_next_;
+    report report_;
+};
+
+} // namespace teseo
+
+#endif // HYBRID_H_
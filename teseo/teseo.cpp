@@ -1,14 +1,51 @@
 #include "teseo.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
 #include<algorithm>
+#include <cstdio>
+#include <charconv>
 
 namespace teseo { 
 
-nmea_rr teseo::gll_("$PSTMNMEAREQUEST,100000,0\r\n", "GLL,");
-nmea_rr teseo::gsv_("$PSTMNMEAREQUEST,80000,0\r\n", "GSV,");
-nmea_rr teseo::gsa_("$PSTMNMEAREQUEST,4,0\r\n", "GSA,");
-nmea_rr teseo::gga_("$PSTMNMEAREQUEST,2,0\r\n", "GGA,");
-nmea_rr teseo::rmc_("$PSTMNMEAREQUEST,40,0\r\n", "RMC,");
-nmea_rr teseo::vtg_("$PSTMNMEAREQUEST,10,0\r\n", "VTG,");
+namespace {
+
+//! walk the data lines of a reply, and validate them and the status line
+/*!
+  visit gets each valid data line, "\r\n" included, and returns false when it can't take more.
+  Returns true if the reply is valid up to where the walk stopped. bad_line tells if a data line failed.
+*/
+template <typename F>
+bool walk_reply(std::string_view reply, const nmea_rr& command, bool& bad_line, F&& visit) {
+    std::size_t string_index = 0;
+    std::size_t new_string_index; // intentionally uninitialised
+    bool valid = false;
+    const std::string_view status(command.first.data(), command.first.length() - 2);
+
+    bad_line = false;
+    bool more = true;
+    while (more) {
+        new_string_index = reply.find("\r\n", string_index);
+        if (new_string_index == reply.length() - 2) {  // exhausted. This should be the status string
+            valid = reply.substr(string_index).starts_with(status);
+            break;
+        }
+        const std::string_view line = reply.substr(string_index, (new_string_index + 2) - string_index); // include the separator
+        valid = line.length() >= 7 && matches_signature(line, command.second);
+        if (!valid) {
+            bad_line = true;
+            break;
+        }
+        more = visit(line);
+        string_index = new_string_index + 2; // skip the separator
+    }
+    return valid;
+}
+
+} // namespace
 
 /*
 when the teseo is preset for i2c according to AN5203,
@@ -20,8 +57,50 @@ https://www.st.com/resource/en/application_note/an5203-teseoliv3f--i2c-positioni
     assert(reader_.is_set());
     assert(resetter_.is_set());
 
-    std::string s;
     resetter_.call();
+    configure();
+}
+
+bool teseo::resync() {
+    assert(writer_.is_set());
+    assert(reader_.is_set());
+
+    TESEO_TRACE_SCOPE("resync");
+    std::string& s = reply_; // reused: recovery doesn't allocate
+
+    // cheapest: the link lost its framing. Throw away partial data and check that replies are valid again
+    drain();
+    if (ask_gll(s)) {
+        return true;
+    }
+
+    // the Teseo may have lost its configuration. Configure without reset: suspend and restart keep the ephemeris
+    TESEO_TRACE_INSTANT("resync: configure");
+    if (configure()) {
+        drain();
+        if (ask_gll(s)) {
+            return true;
+        }
+    }
+
+    // last resort: full reset, if the developer provided a resetter
+    if (!resetter_.is_set()) {
+        return false;
+    }
+    TESEO_TRACE_INSTANT("resync: reset");
+    initialize();
+    return ask_gll(s);
+}
+
+void teseo::standby(unsigned int seconds) {
+    assert(seconds <= 99999); // 5 digits
+    char command[32];
+    std::snprintf(command, sizeof(command), "$PSTMFORCESTANDBY,%05u\r\n", seconds);
+    write(command);
+}
+
+bool teseo::configure() {
+    std::string& s = reply_; // reused: recovery doesn't allocate
 
     // stop the engine
     write("$PSTMGPSSUSPEND\r\n");
@@ -32,93 +111,232 @@ https://www.st.com/resource/en/application_note/an5203-teseoliv3f--i2c-positioni
     write("$PSTMCFGMSGL,3,1,0,0\r\n");
     // disable the eco-ing message
     write("$PSTMSETPAR,1227,1,2\r\n");
+    if (static_cast<unsigned int>(constellations_)) {
+        char command[32];
+        std::snprintf(command, sizeof(command), "$PSTMSETCONSTMASK,%u\r\n", static_cast<unsigned int>(constellations_));
+        write(command);
+    }
 
     // restart the engine
     write("$PSTMGPSRESTART\r\n");
+    // a streaming or garbled link never returns the acknowledge. Give up after max_drain_reads_
+    unsigned int reads = 0;
     do {
-        read(s);            
+        read(s);
+        reads++;
+        if (s.find("$PSTMGPSRESTART") != std::string::npos) {
+            return true; // command successful
+        }
     }
-    while(((s.length()) && s.find("$PSTMGPSRESTART") == std::string::npos)); // command successful
+    while(s.length() && reads < max_drain_reads_);
+    return false;
 }
 
-bool teseo::parse_multiline_reply(std::span<std::string> strings, const std::string s, unsigned int& count, const nmea_rr& command) {
-    std::size_t message_count = strings.size();
-    std::size_t string_index = 0;
-    std::size_t new_string_index; // intentionally uninitialised
-    std::size_t vector_index; // intentionally uninitialised
-    bool valid = false;
+void teseo::drain() {
+    std::string& s = reply_; // reused: recovery doesn't allocate
+    unsigned int reads = 0;
+    do {
+        read(s);
+        reads++;
+    }
+    while(s.length() && reads < max_drain_reads_);
+}
 
-    for(vector_index = 0; vector_index < message_count; vector_index++) {
-        new_string_index = s.find("\r\n", string_index);
-        if (new_string_index == s.length() - 2) {  // exhausted. This should be the status string
-            valid = s.substr(string_index, s.length() - string_index).starts_with(command.first.substr(0, command.first.length()-2));
-            break;
-        }
-        assert(vector_index < message_count);
-        strings[vector_index] = s.substr(string_index, (new_string_index + 2) - string_index); // include the separator
-        valid = strings[vector_index].length() >= 7 && strings[vector_index].substr(3, 4).starts_with(command.second);
-        if (!valid) {
-            vector_index = 0;
-            break;
-        }
-        string_index = new_string_index + 2; // skip the separator
+bool teseo::parse_multiline_reply(std::span<std::string> strings, const std::string& s, unsigned int& count, const nmea_rr& command,
+        const nmea_filter& filter) {
+    TESEO_TRACE_SCOPE("parse");
+    std::size_t vector_index = 0;
+    bool valid = false;
+    bool bad_line = false;
+    if (!strings.empty()) {
+        // views on the reply, so that validation doesn't create temporary strings
+        valid = walk_reply(s, command, bad_line, [&strings, &vector_index, &filter](std::string_view line) -> bool {
+            if (filter.accept(line)) {
+                strings[vector_index].assign(line); // reuses the capacity of the previous poll
+                vector_index++;
+            }
+            return vector_index < strings.size();
+        });
+    }
+    if (bad_line) {
+        vector_index = 0;
     }
     count = vector_index; // report the number of retrieved data lines.
     std::for_each(strings.begin() + count, strings.end(),
-        [](auto &discard) { discard = std::string(); }); // clean out unused positions
+        [](auto &discard) { discard.clear(); }); // clean out unused positions, keep their capacity
     return valid;
 }
 
+bool nmea_filter::accept(std::string_view line) const {
+    const std::string_view talker = line.substr(1, 2);
+    const std::string_view sentence = line.substr(3, 3);
+    if (!talkers.empty() && std::find(talkers.begin(), talkers.end(), talker) == talkers.end()) {
+        return false;
+    }
+    if (!sentences.empty() && std::find(sentences.begin(), sentences.end(), sentence) == sentences.end()) {
+        return false;
+    }
+    if (min_quality && sentence == "GGA") {
+        // the fix quality is the first character after the 6th comma
+        std::size_t index = 0;
+        for (unsigned int field = 0; field < 6 && index != std::string_view::npos; field++) {
+            index = line.find(',', index + 1);
+        }
+        if (index == std::string_view::npos || index + 1 >= line.length()) {
+            return false;
+        }
+        const char quality = line[index + 1];
+        return quality >= '0' && quality <= '9' && static_cast<unsigned int>(quality - '0') >= min_quality;
+    }
+    return true;
+}
+
 void teseo::write(const std::string& s) {
+    TESEO_TRACE_SCOPE("write");
     assert(writer_.is_set());
     writer_.call(s);
 }
 
+void teseo::send(const nmea_rr& command) {
+    request_.assign(command.first); // keeps its capacity
+    write(request_);
+}
+
 void teseo::read(std::string& s) {
+    TESEO_TRACE_SCOPE("read");
     assert(reader_.is_set());
     reader_.call(s);
+    reply_time_ = clock_.call();
 }
 
 bool teseo::ask_nmea(const nmea_rr& command, std::string& s) {
     bool retval; // intentionally not initialised
     unsigned int count;
-    write(command.first);
+    send(command);
     read(s);
     retval = parse_multiline_reply(single_line_parser_, s, count, command);
-    s = single_line_parser_[0];    
+    tally(retval, s, command);
+    s.swap(single_line_parser_[0]); // no copy. The parser keeps a buffer with capacity for the next call
+    if (retval) {
+        tally_fix(s);
+    }
     return retval;
 }
 
-bool teseo::ask_nmea_multiple(const nmea_rr& command, std::span<std::string> strings, unsigned int& count) {
+bool teseo::ask_nmea_multiple(const nmea_rr& command, std::span<std::string> strings, unsigned int& count, const nmea_filter& filter) {
     unsigned int retval; // intentionally not initialised
-    std::string s;
-    write(command.first);
-    read(s);
-    retval = parse_multiline_reply(strings, s, count, command);
+    send(command);
+    read(reply_);
+    retval = parse_multiline_reply(strings, reply_, count, command, filter);
+    tally(retval, reply_, command);
     return retval;
 }
 
+bool teseo::ask_nmea_multiple(const nmea_rr& command, packed_reply& reply, const nmea_filter& filter) {
+    send(command);
+    read(reply.buffer_);
+    TESEO_TRACE_SCOPE("parse");
+    std::size_t count = 0;
+    std::size_t dropped = 0;
+    bool bad_line;
+    const char* base = reply.buffer_.data();
+    reply.valid_ = walk_reply(reply.buffer_, command, bad_line, [&reply, &count, &dropped, &filter, base](std::string_view line) -> bool {
+        if (!filter.accept(line)) {
+            return true;
+        }
+        if (count < packed_reply::max_lines) {
+            reply.lines_[count] = {static_cast<uint32_t>(line.data() - base), static_cast<uint32_t>(line.length())};
+            count++;
+        } else {
+            dropped++;
+        }
+        return true; // a full table doesn't stop the validation of the rest of the reply
+    });
+    reply.count_ = reply.valid_ ? count : 0;
+    reply.dropped_ = reply.valid_ ? dropped : 0;
+    tally(reply.valid_, reply.buffer_, command);
+    return reply.valid_;
+}
+
+void teseo::tally(bool valid, std::string_view reply, const nmea_rr& command) {
+    if (valid) {
+        tally(true, true);
+        return;
+    }
+    // was the status line there? It is the last line of the reply. No reply at all is not a missing status line
+    if (reply.empty()) {
+        tally(false, true);
+        return;
+    }
+    std::size_t last = reply.length() > 2 ? reply.rfind("\r\n", reply.length() - 3) : std::string_view::npos;
+    last = (last == std::string_view::npos) ? 0 : last + 2;
+    tally(false, reply.substr(last).starts_with(std::string_view(command.first.data(), command.first.length() - 2)));
+}
+
+void teseo::tally(bool valid, bool status_line) {
+    counters_.requests++;
+    if (valid) {
+        counters_.valid_replies++;
+        return;
+    }
+    counters_.invalid_replies++;
+    if (!status_line) {
+        counters_.status_failures++;
+    }
+}
+
+void teseo::tally_fix(std::string_view line) {
+    if (line.length() < 7) {
+        return;
+    }
+    const std::string_view type = line.substr(3, 3);
+    if (type == "GGA") {
+        static const nmea_filter has_fix {.min_quality = 1};
+        counters_.fixes += has_fix.accept(line);
+    } else if (type == "RMC") {
+        // status is the 2nd field: A valid, V no fix
+        std::size_t index = line.find(',', line.find(',') + 1);
+        if (index != std::string_view::npos && index + 1 < line.length()) {
+            counters_.fixes += (line[index + 1] == 'A');
+        }
+    }
+}
+
+bool teseo::ask_cpu_load(float& percent) {
+    std::string& s = reply_; // a local string would take the parser's buffer with it, and allocate on each call
+    if (!ask<sentence::cpu>(s)) {
+        return false;
+    }
+    // $PSTMCPU,<CPU usage>,<PLL on/off>,<CPU speed>*<checksum>
+    std::size_t start = s.find(',') + 1;
+    std::size_t end = s.find(',', start);
+    if (end == std::string::npos) {
+        return false;
+    }
+    return std::from_chars(s.data() + start, s.data() + end, percent).ec == std::errc();
+}
+
 bool teseo::ask_gll(std::string& s) {
-    return ask_nmea(gll_, s);
+    return ask<sentence::gll>(s);
 }
 
-bool teseo::ask_gsv(std::span<std::string> strings, unsigned int& count) {
-    return ask_nmea_multiple(gsv_, strings, count);
+bool teseo::ask_gsv(std::span<std::string> strings, unsigned int& count, const nmea_filter& filter) {
+    return ask<sentence::gsv>(strings, count, filter);
 }
 
-bool teseo::ask_gsa(std::span<std::string> strings, unsigned int& count) {
-    return ask_nmea_multiple(gsa_, strings, count);
+bool teseo::ask_gsa(std::span<std::string> strings, unsigned int& count, const nmea_filter& filter) {
+    return ask<sentence::gsa>(strings, count, filter);
 }
 bool teseo::ask_gga(std::string& s) {
-    return ask_nmea(gga_, s);
+    return ask<sentence::gga>(s);
 }
 
 bool teseo::ask_rmc(std::string& s) {
-    return ask_nmea(rmc_, s);
+    return ask<sentence::rmc>(s);
 }
 
 bool teseo::ask_vtg(std::string& s) {
-    return ask_nmea(vtg_, s);
+    return ask<sentence::vtg>(s);
 }
 
 } // namespace teseo
\ No newline at end of file
@@ -2,18 +2,231 @@
 #define TESEO_H_
 
 #include <string>
+#include <string_view>
+#include <array>
 #include "callbackmanager.h"
 // std::pair
 #include <utility> 
 #include <cassert>
 #include <span>
+#include <cstdint>
 
 namespace teseo {
 
 /**
- * A std::pair to hold a NMEA command and its reply signature validation string
+ * A std::pair to hold a NMEA command and its reply signature validation string.
+ * Views: constexpr data, without construction at startup. The strings have to outlive the pair.
 */
-using nmea_rr = const std::pair<const std::string, const std::string>;
+using nmea_rr = const std::pair<const std::string_view, const std::string_view>;
+
+//! Filter for the lines of a multi line reply
+/*!
+  Evaluated on the first bytes of each line, before the line is copied. Rejected lines cost a few byte compares.  
+  An empty talker or sentence set accepts all. The sets are not copied. They have to outlive the filter.
+
+  Example code:
+  @code
+  static constexpr std::array<std::string_view, 1> gps_talker {"GP"};
+  teseo::nmea_filter gps_only {.talkers = gps_talker};
+  gps.ask_gsv(strings, count, gps_only);
+  @endcode
+*/
+struct nmea_filter {
+    //! accepted talker IDs, e.g.: "GP", "GL", "GA", "BD", "GN"
+    std::span<const std::string_view> talkers = {};
+    //! accepted sentence types, e.g.: "GSV", "GSA"
+    std::span<const std::string_view> sentences = {};
+    //! minimum fix quality of GGA lines (field 6). 0 accepts all. Other sentences are not checked.
+    /*!
+      For the streams that carry GGA among other lines: relay and hybrid. The single line ask_gga() doesn't take a filter:
+      check its reply with accept().
+    */
+    unsigned int min_quality = 0;
+
+    //! check if a line passes the filter
+    /*!
+      \param line std::string_view one NMEA sentence, starting with '$'. At least 7 characters.  
+      \returns bool true if the line is accepted
+    */
+    bool accept(std::string_view line) const;
+};
+
+//! Owned multi line reply
+/*!
+  Holds the raw reply in one buffer, and a table with the position of each line in it. The lines are exposed as
+  std::string_view, "\r\n" included. Filling it costs no allocation per line, and once the buffer has grown, none at all.  
+  Moving it to another thread is O(1): the buffer moves, the table is a fixed size array.  
+  To pool buffers: release() the buffer when done, and construct the next reply from it.
+
+  Example code:
+  @code
+  teseo::packed_reply reply;
+  if (gps.ask<teseo::sentence::gsv>(reply)) {
+    consumer.push(std::move(reply));
+  }
+  // consumer thread
+  for (std::size_t i = 0; i < reply.size(); i++) {
+    std::string_view line = reply[i];
+  }
+  @endcode
+*/
+class packed_reply {
+public:
+
+    //! most lines in the table. Further lines are validated, but not added: see dropped()
+    static constexpr std::size_t max_lines = 32;
+
+    //! constructor.
+    packed_reply() : buffer_(), lines_(), count_(0), dropped_(0), valid_(false) {}
+
+    //! constructor, with a buffer from a pool. Its capacity is reused
+    /*!
+      \param buffer std::string rvalue reference. Its content is discarded.
+    */
+    packed_reply(std::string&& buffer) : buffer_(std::move(buffer)), lines_(), count_(0), dropped_(0), valid_(false) {
+        buffer_.clear();
+    }
+
+    //! number of lines
+    inline std::size_t size() const {
+        return count_;
+    }
+
+    //! the reply passed validation
+    inline bool valid() const {
+        return valid_;
+    }
+
+    //! lines that passed the filter, but didn't fit in the table. A valid reply with dropped lines is incomplete
+    inline std::size_t dropped() const {
+        return dropped_;
+    }
+
+    //! a line, "\r\n" included. Valid as long as the reply isn't changed or destroyed
+    inline std::string_view operator[](std::size_t index) const {
+        assert(index < count_);
+        return std::string_view(buffer_).substr(lines_[index].offset, lines_[index].length);
+    }
+
+    //! the reply as it was read, status line included
+    inline std::string_view raw() const {
+        return buffer_;
+    }
+
+    //! give the buffer back, e.g.: to a pool. The reply is empty after this
+    inline std::string release() {
+        count_ = 0;
+        dropped_ = 0;
+        valid_ = false;
+        return std::move(buffer_);
+    }
+
+private:
+    friend class teseo;
+
+    struct line {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::string buffer_;
+    std::array<line, max_lines> lines_;
+    std::size_t count_;
+    std::size_t dropped_;
+    bool valid_;
+};
+
+//! NMEA sentences that the Teseo can be asked for
+/*!
+  Each type holds the request and the reply signature. Use them with teseo::ask<>().  
+  The driver only instantiates the commands that a project asks for. With -ffunction-sections and
+  -Wl,--gc-sections, the linker drops the rest.  
+  multi_line: the Teseo replies with more than one line.
+*/
+namespace sentence {
+    //! GLL: geographic position
+    struct gll {
+        static constexpr std::string_view request = "$PSTMNMEAREQUEST,100000,0\r\n";
+        static constexpr std::string_view signature = "GLL,";
+        static constexpr bool multi_line = false;
+    };
+    //! GSV: satellites in view
+    struct gsv {
+        static constexpr std::string_view request = "$PSTMNMEAREQUEST,80000,0\r\n";
+        static constexpr std::string_view signature = "GSV,";
+        static constexpr bool multi_line = true;
+    };
+    //! GSA: DOP and active satellites
+    struct gsa {
+        static constexpr std::string_view request = "$PSTMNMEAREQUEST,4,0\r\n";
+        static constexpr std::string_view signature = "GSA,";
+        static constexpr bool multi_line = true;
+    };
+    //! GGA: fix data
+    struct gga {
+        static constexpr std::string_view request = "$PSTMNMEAREQUEST,2,0\r\n";
+        static constexpr std::string_view signature = "GGA,";
+        static constexpr bool multi_line = false;
+    };
+    //! RMC: recommended minimum data
+    struct rmc {
+        static constexpr std::string_view request = "$PSTMNMEAREQUEST,40,0\r\n";
+        static constexpr std::string_view signature = "RMC,";
+        static constexpr bool multi_line = false;
+    };
+    //! VTG: course and speed
+    struct vtg {
+        static constexpr std::string_view request = "$PSTMNMEAREQUEST,10,0\r\n";
+        static constexpr std::string_view signature = "VTG,";
+        static constexpr bool multi_line = false;
+    };
+    //! $PSTMCPU: Teseo CPU load
+    struct cpu {
+        static constexpr std::string_view request = "$PSTMNMEAREQUEST,800000,0\r\n";
+        static constexpr std::string_view signature = "PSTMCPU,";
+        static constexpr bool multi_line = false;
+    };
+} // namespace sentence
+
+//! check a reply line against a sentence signature
+/*!
+  \param line std::string_view one reply line, starting with '$'. At least 7 characters.  
+  \param signature std::string_view e.g.: sentence::gga::signature.  
+  \returns bool true if the line is of that sentence type  
+
+  Standard NMEA sentences: the signature follows the talker ID ("$GPGGA," matches "GGA,").
+  Teseo proprietary $PSTM sentences have no talker ID: the signature follows the '$' ("$PSTMCPU," matches "PSTMCPU,").
+*/
+inline bool matches_signature(std::string_view line, std::string_view signature) {
+    return (line.starts_with("$PSTM") ? line.substr(1) : line.substr(3)).starts_with(signature);
+}
+
+//! GNSS constellations that the Teseo tracks. Combine with |
+enum class constellation : unsigned int {
+    gps = 0x01,
+    glonass = 0x02,
+    qzss = 0x04,
+    galileo = 0x08,
+    beidou = 0x80
+};
+
+constexpr constellation operator|(constellation a, constellation b) {
+    return static_cast<constellation>(static_cast<unsigned int>(a) | static_cast<unsigned int>(b));
+}
+
+//! Driver health counters. They only count up. Compare two snapshots to get the rate.
+struct counters {
+    //! NMEA requests sent with ask_*()
+    unsigned long requests = 0;
+    //! replies that passed validation
+    unsigned long valid_replies = 0;
+    //! replies that failed validation
+    unsigned long invalid_replies = 0;
+    //! invalid replies without the status line. A request without any reply is not one of them
+    unsigned long status_failures = 0;
+    //! valid GGA and RMC replies that report a fix
+    unsigned long fixes = 0;
+};
 
 //! Driver class for ST Teseo IC.
 /*!
@@ -23,18 +236,22 @@ using nmea_rr = const std::pair<const std::string, const std::string>;
   - writing comms protocol  
   - reading comms protocol  
   - resetting the Teseo (optional, see init() documentation)  
+  Not copyable or movable, because its callback managers aren't. Construct it in place, and pass it by reference.
  */
 class teseo {
 public:
 
     //! constructor.
-    teseo() : single_line_parser_() {}
+    teseo() : reply_time_(0), constellations_(static_cast<constellation>(0)), single_line_parser_(), counters_(), reply_(), request_() {}
 
     //! expose the callback manager for writing to Teseo.
     /*!
       The developer has to register the logic for writing to the device.  
       Callback parameter: const std::string reference with data to be written to Teseo.  
       This can be a C style function, an object method, a static class object method, or lambda code.  
+      The handler can be replaced at runtime (e.g.: fail over from I2C to UART) while other threads poll.
+      Calls in progress finish on the old handler. Replace writer and reader together. A request that was
+      written on the old link and read on the new one fails validation, and can be retried.  
 
       Example code:
       @code
@@ -76,6 +293,35 @@ public:
         return resetter_;
     }
 
+    //! expose the callback manager for the host clock (optional)
+    /*!
+      When set, the driver timestamps the arrival of each reply with it. See reply_time().  
+      The handler returns a monotonic host time in µs, e.g.: time_us_64() on a Pico.  
+      Callback parameter: none.  
+      For instructions on how to register your handler, check the documentation of writer().
+    */
+    inline Callback<uint64_t>& clock() {
+        return clock_;
+    }
+
+    //! host time at which the last reply arrived
+    /*!
+      \returns uint64_t the clock() value, taken when the reader handler returned. 0 if no clock is set.  
+
+      Pair it with the UTC time of the decoded fix in clock_sync, to map GNSS time to host time.
+    */
+    inline uint64_t reply_time() const {
+        return reply_time_;
+    }
+
+    //! expose the health counters
+    /*!
+      Plain counters, updated by the ask_*() methods. Read them from the thread that polls. See health_monitor.
+    */
+    inline const counters& statistics() const {
+        return counters_;
+    }
+
     //! configure the Teseo for use as a position sensor (optional).
     /*!
     init() is used for dynamic configuration of the Teseo.  
@@ -88,17 +334,61 @@ public:
     */
     void initialize();
 
+    //! select the constellations to track
+    /*!
+      \param c constellation, e.g.: constellation::gps | constellation::galileo  
+
+      Applied by the next initialize() or resync() escalation, with $PSTMSETCONSTMASK while the engine is suspended.
+      Each added constellation raises the Teseo CPU load (see ask_cpu_load()), and the number of GSV lines per poll.
+      It can shorten the time to first fix. Default: the Teseo's stored configuration is kept.
+    */
+    inline void constellations(constellation c) {
+        constellations_ = c;
+    }
+
+    //! recover the communication with the Teseo, without a reset if possible
+    /*!
+      \returns bool true if the Teseo replies valid again
+
+      Use after a bus glitch or brown-out, instead of initialize(). Escalates step by step:  
+      - discard pending partial data, and probe with a GLL request  
+      - reapply the configuration of initialize(), without reset. The engine restarts with its almanac and ephemeris intact.
+        If the restart is acknowledged, probe again  
+      - only when that fails: initialize(), if a resetter callback is set  
+
+      The configuration isn't read back (e.g.: with $PSTMGETPAR) before it's reapplied. A probe that fails after a
+      drain is the sign that the link or the configuration is lost, and writing the few settings costs about as much
+      as reading them. Each step reads at most max_drain_reads_ times, so that resync() returns on a link that
+      streams or returns garbage.  
+
+      Precondition (asserted): the writer and reader handlers have to be set.
+    */
+    bool resync();
+
+    //! put the Teseo in standby for a fixed time
+    /*!
+      \param seconds unsigned int standby duration. The Teseo wakes up by itself when it expires.  
+
+      Sends $PSTMFORCESTANDBY. The RTC and backup RAM stay powered, so that the Teseo can hot start
+      after wake-up, without the reset of initialize().  
+      The Teseo doesn't reply during standby. See duty_cycle for a controller that schedules it.
+    */
+    void standby(unsigned int seconds);
+
     //! utility to parse a multiline Teseo reply into separate strings
     /*!
       \param strings std::span<std::string> will get the individual strings.  
-      \param s constant std::string reference string to be parsed.  
+      \param s constant std::string reference string to be parsed. It is not copied.  
       \param count unsigned int reference gets count of strings parsed.  
       \param command nmea_rr const reference used to validate the status line.  
+      \param filter nmea_filter const reference. Lines that it rejects are validated, but not copied or counted.  
       \returns  bool true if valid reply 
 
-      split a big Teseo reply in its individual strings. The separator is "\r\n"
+      split a big Teseo reply in its individual strings. The separator is "\r\n"  
+      The strings in the span are assigned in place. They keep their capacity between calls.
     */
-    static bool parse_multiline_reply(std::span<std::string> strings, const std::string s, unsigned int& count, const nmea_rr& command);
+    static bool parse_multiline_reply(std::span<std::string> strings, const std::string& s, unsigned int& count, const nmea_rr& command,
+            const nmea_filter& filter = nmea_filter());
 
     //! write command to the Teseo
     /*!
@@ -133,11 +423,70 @@ public:
       \param command const nmea_rr reference holds the NMEA command.   
       \param strings astd::span<std::string> gets the replies. 
       \param count unsigned int reference count of strings parsed.  
+      \param filter nmea_filter const reference selects the lines to return. Default: all.  
       \returns  bool true if valid reply 
 
       Send NMEA request that expects more than 1 reply to the Teseo. Validate and Return the repies.
     */    
-    bool ask_nmea_multiple(const nmea_rr& command, std::span<std::string> strings, unsigned int& count);
+    bool ask_nmea_multiple(const nmea_rr& command, std::span<std::string> strings, unsigned int& count, const nmea_filter& filter = nmea_filter());
+
+    //! send NMEA request to the Teseo and return the multi line reply in one buffer
+    /*!
+      \param command const nmea_rr reference holds the NMEA command.   
+      \param reply packed_reply reference gets the reply. Its buffer is reused.  
+      \param filter nmea_filter const reference selects the lines to return. Default: all.  
+      \returns  bool true if valid reply 
+
+      As ask_nmea_multiple(const nmea_rr&, std::span<std::string>, unsigned int&, const nmea_filter&),
+      without a copy per line.
+    */    
+    bool ask_nmea_multiple(const nmea_rr& command, packed_reply& reply, const nmea_filter& filter = nmea_filter());
+
+    //! the command for a sentence type. constexpr data: no constructor, no guard. Only the sentence types that are used get one.
+    template <typename S>
+    static constexpr nmea_rr command {S::request, S::signature};
+
+    //! send a request for a single line sentence to the Teseo and return the reply
+    /*!
+      \param s std::string reference gets the reply.  
+      \returns bool true if valid reply  
+
+      Example: gps.ask<teseo::sentence::gga>(s);
+    */
+    template <typename S> requires (!S::multi_line)
+    bool ask(std::string& s) {
+        return ask_nmea(command<S>, s);
+    }
+
+    //! send a request for a multi line sentence to the Teseo and return the replies
+    /*!
+      \param strings std::span<std::string> gets the replies.  
+      \param count unsigned int reference gets count of replies.  
+      \param filter nmea_filter const reference selects the lines to return. Default: all.  
+      \returns bool true if validated.
+    */
+    template <typename S> requires (S::multi_line)
+    bool ask(std::span<std::string> strings, unsigned int& count, const nmea_filter& filter = nmea_filter()) {
+        return ask_nmea_multiple(command<S>, strings, count, filter);
+    }
+
+    //! send a request for a multi line sentence to the Teseo and return the reply in one buffer
+    /*!
+      \param reply packed_reply reference gets the reply.  
+      \param filter nmea_filter const reference selects the lines to return. Default: all.  
+      \returns bool true if validated.
+    */
+    template <typename S> requires (S::multi_line)
+    bool ask(packed_reply& reply, const nmea_filter& filter = nmea_filter()) {
+        return ask_nmea_multiple(command<S>, reply, filter);
+    }
+
+    //! get the Teseo CPU load
+    /*!
+      \param percent float reference gets the CPU usage, from $PSTMCPU.  
+      \returns bool true if valid reply
+    */
+    bool ask_cpu_load(float& percent);
 
     //! get GLL request to the Teseo and read reply
     /*!
@@ -152,21 +501,23 @@ public:
     /*!
       \param strings std::span<std::string> gets the reply. 
       \param count unsigned int reference gets count of replies. 
+      \param filter nmea_filter const reference selects the lines to return. Default: all.  
       \returns boold true if validated.
 
       Send request for GSV data to the Teseo. Retrieve the replies.
     */    
-    bool ask_gsv(std::span<std::string> strings, unsigned int& count);
+    bool ask_gsv(std::span<std::string> strings, unsigned int& count, const nmea_filter& filter = nmea_filter());
 
     //! get GSA request to the Teseo and read reply
     /*!
       \param strings std::span<std::string> gets the reply. 
       \param count unsigned int reference gets count of replies. 
+      \param filter nmea_filter const reference selects the lines to return. Default: all.  
       \returns boold true if validated.
 
       Send request for GSA data to the Teseo. Retrieve the replies.
     */    
-    bool ask_gsa(std::span<std::string> strings, unsigned int& count);
+    bool ask_gsa(std::span<std::string> strings, unsigned int& count, const nmea_filter& filter = nmea_filter());
 
     //! get RMC request to the Teseo and read reply
     /*!
@@ -196,27 +547,52 @@ public:
     bool ask_vtg(std::string& s);
 
 private:
+    //! polls on a streaming link update the health counters too
+    friend class hybrid;
+
+    //! suspend the engine, set the message lists and echo off, restart the engine
+    /*!
+      \returns bool true if the Teseo acknowledged the restart within max_drain_reads_ reads
+    */
+    bool configure();
+
+    //! read and discard until the Teseo has no more pending data
+    void drain();
+
+    //! update the health counters for a reply
+    void tally(bool valid, std::string_view reply, const nmea_rr& command);
+
+    //! update the health counters for a reply, when the caller knows if the status line was there
+    void tally(bool valid, bool status_line);
+
+    //! count the fix, if the line is a GGA or RMC that reports one
+    void tally_fix(std::string_view line);
+
+    //! write the request of a command, from request_
+    void send(const nmea_rr& command);
 
-    //! command to retrieve GLL data
-    static nmea_rr gll_;
-    //! command to retrieve GSV data
-    static nmea_rr gsv_;
-    //! command to retrieve GSA data
-    static nmea_rr gsa_;
-    //! command to retrieve GGA data
-    static nmea_rr gga_;
-    //! command to retrieve RMC data
-    static nmea_rr rmc_;
-    //! command to retrieve VTG data
-    static nmea_rr vtg_;
+    //! upper limit for drain() and configure(), for a link that keeps returning data
+    static constexpr unsigned int max_drain_reads_ = 8;
     //! callback manager for writing to the Teseo
     Callback<void, const std::string&> writer_;
     //! callback manager for reading from the Teseo
     Callback<void, std::string&> reader_;
     //! callback manager for resetting the Teseo
     Callback<void> resetter_;
+    //! callback manager for the host clock
+    Callback<uint64_t> clock_;
+    //! host time of the last reply
+    uint64_t reply_time_;
+    //! constellations to configure. 0: keep the Teseo's configuration
+    constellation constellations_;
     //! every single line NMEA command has two lines. reply and status
     std::array<std::string,2> single_line_parser_;
+    //! health counters
+    counters counters_;
+    //! receive buffer for multi line replies, ask_cpu_load() and the recovery steps. Reused, so that a poll doesn't allocate once it has grown
+    std::string reply_;
+    //! send buffer for the requests, for the writer's std::string. Reused, so that a poll doesn't allocate
+    std::string request_;
 
 };
 
@@ -0,0 +1,49 @@
+// host test for Callback
+// g++ -std=c++20 -Icallbackmanager test/callbackmanager_test.cpp -o callbackmanager_test -pthread && ./callbackmanager_test
+
+#undef NDEBUG
+#include "callbackmanager.h"
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <type_traits>
+
+static_assert(!std::is_copy_constructible_v<Callback<void>> && !std::is_move_constructible_v<Callback<void>>);
+
+namespace {
+
+// a handler that throws doesn't leave its slot pinned
+void throwing_handler() {
+    Callback<int> c;
+    c.set([]() -> int { throw std::runtime_error("bus error"); });
+    try {
+        c.call();
+        assert(false);
+    } catch (const std::runtime_error&) {
+    }
+    // both slots are reused. Each set() would wait forever on a slot that stayed pinned
+    c.set([]() -> int { return 1; });
+    c.set([]() -> int { return 2; });
+    c.set([]() -> int { return 3; });
+    assert(c.call() == 3);
+}
+
+// a handler can replace itself
+void set_from_handler() {
+    Callback<int> c;
+    c.set([&c]() -> int {
+        c.set([]() -> int { return 2; });
+        return 1;
+    });
+    assert(c.call() == 1);
+    assert(c.call() == 2);
+}
+
+} // namespace
+
+int main() {
+    throwing_handler();
+    set_from_handler();
+    std::puts("callbackmanager_test: passed");
+    return 0;
+}
@@ -0,0 +1,105 @@
+// host test for clock_sync
+// g++ -std=c++20 -Iteseo test/clock_sync_test.cpp teseo/clock_sync.cpp -o clock_sync_test && ./clock_sync_test
+
+#undef NDEBUG
+#include "clock_sync.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// GNSS runs 1 s ahead of the host, and the host clock is 20 ppm slow
+int64_t gnss_of(int64_t host_us) {
+    return 1000000 + host_us + host_us / 50000;
+}
+
+// inverse of gnss_of()
+int64_t host_of(int64_t gnss_us) {
+    return (gnss_us - 1000000) * 50000 / 50001;
+}
+
+// deterministic jitter in [-range, range]
+int64_t jitter(uint32_t& state, int64_t range) {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<int64_t>(state >> 8) % (2 * range + 1) - range;
+}
+
+// replies arrive 80 ms after the second they report, with 300 µs jitter. PPS edges measure that latency
+void pps_with_latency() {
+    const int64_t latency = 80000;
+    teseo::clock_sync sync;
+    uint32_t state = 1;
+    unsigned int accepted = 0;
+    int64_t second = 0;
+    for (int i = 0; i < 8; i++, second += 1000000) {
+        assert(sync.add(host_of(second) + latency + jitter(state, 300), second));
+    }
+    // without PPS, the reply fit is late by the latency
+    assert(std::abs(sync.to_gnss(host_of(second)) - second + latency) < 1000);
+
+    for (int i = 0; i < 100; i++, second += 1000000) {
+        accepted += sync.add_pps(host_of(second) + jitter(state, 2)) ? 1 : 0;
+        sync.add(host_of(second) + latency + jitter(state, 300), second);
+    }
+    assert(accepted == 100);
+    assert(std::abs(sync.latency_us() - latency) < 500);
+    assert(std::abs(sync.to_gnss(host_of(second)) - second) < 20);
+    assert(std::abs(sync.to_host(second) - host_of(second)) < 20);
+    assert(sync.uncertainty_us() < 20);
+
+    // PPS stops. The reply fit takes over, corrected by the measured latency
+    for (int i = 0; i < 4; i++, second += 1000000) {
+        sync.add(host_of(second) + latency + jitter(state, 300), second);
+    }
+    assert(std::abs(sync.to_gnss(host_of(second)) - second) < 1000);
+    assert(sync.uncertainty_us() < 1000);
+}
+
+// before a latency is measured, the uncertainty includes the expected latency
+void expected_latency() {
+    teseo::clock_sync sync(3.0, 80000.0);
+    int64_t second = 0;
+    for (int i = 0; i < 8; i++, second += 1000000) {
+        assert(sync.add(host_of(second) + 80000, second));
+    }
+    assert(std::abs(sync.to_gnss(host_of(second)) - second) < 10);
+    assert(sync.uncertainty_us() >= 80000.0);
+}
+
+// the model follows a host clock jump within a window of samples
+void host_clock_jump() {
+    teseo::clock_sync sync;
+    int64_t host = 0;
+    int64_t gnss = 0;
+    for (int i = 0; i < 40; i++, host += 1000000) {
+        gnss = gnss_of(host);
+        assert(sync.add(host, gnss));
+    }
+    assert(std::abs(sync.to_gnss(host) - gnss_of(host)) < 10);
+
+    // the host clock jumps 501 s ahead. GNSS time continues
+    const int64_t jump = 501000000;
+    int64_t worst_after_recovery = 0;
+    for (int i = 0; i < 64; i++, host += 1000000) {
+        gnss += 1000000;
+        sync.add(host + jump, gnss);
+        if (i >= 24) { // window / 2 rejections, then min_samples to refit
+            assert(sync.valid());
+            worst_after_recovery = std::max(worst_after_recovery, std::abs(sync.to_gnss(host + jump) - gnss));
+        }
+    }
+    assert(worst_after_recovery < 1000);
+}
+
+} // namespace
+
+int main() {
+    host_clock_jump();
+    pps_with_latency();
+    expected_latency();
+    std::puts("clock_sync_test: passed");
+    return 0;
+}
@@ -0,0 +1,153 @@
+// host test for teseo::command_queue
+// g++ -std=c++20 -pthread -Icallbackmanager -Iteseo test/command_queue_test.cpp teseo/command_queue.cpp teseo/teseo.cpp -o command_queue_test && ./command_queue_test
+
+#undef NDEBUG
+#include "command_queue.h"
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// many producers: every request runs once, in submission order per producer
+void many_producers() {
+    constexpr unsigned int producers = 8;
+    constexpr unsigned int per_producer = 20000;
+    teseo::teseo gps;
+    teseo::command_queue queue(gps);
+    // written by the I/O thread only
+    std::vector<std::vector<unsigned int>> executed(producers);
+    std::atomic<unsigned int> completed {0};
+
+    std::vector<std::thread> threads;
+    for (unsigned int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, &executed, &completed, p]() {
+            std::vector<std::unique_ptr<teseo::command_queue::request>> requests;
+            requests.reserve(per_producer);
+            for (unsigned int i = 0; i < per_producer; i++) {
+                requests.push_back(std::make_unique<teseo::command_queue::request>(
+                    [&executed, p, i](teseo::teseo&) -> bool { executed[p].push_back(i); return true; },
+                    [&completed](bool result) -> void { assert(result); completed.fetch_add(1, std::memory_order_release); }));
+                queue.submit(*requests.back());
+            }
+            // the requests have to outlive their completion
+            while (completed.load(std::memory_order_acquire) < producers * per_producer) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    std::size_t ran = 0;
+    while (ran < producers * per_producer) {
+        ran += queue.run(64);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (const auto& order : executed) {
+        assert(order.size() == per_producer);
+        for (unsigned int i = 0; i < per_producer; i++) {
+            assert(order[i] == i);
+        }
+    }
+}
+
+// run() executes at most max_batch requests
+void batch() {
+    teseo::teseo gps;
+    teseo::command_queue queue(gps);
+    unsigned int executed = 0;
+    std::vector<std::unique_ptr<teseo::command_queue::request>> requests;
+    for (unsigned int i = 0; i < 10; i++) {
+        requests.push_back(std::make_unique<teseo::command_queue::request>(
+            [&executed](teseo::teseo&) -> bool { executed++; return true; }));
+        queue.submit(*requests.back());
+    }
+    assert(queue.run(3) == 3);
+    assert(executed == 3);
+    assert(queue.run() == 7);
+    assert(queue.run() == 0);
+    assert(executed == 10);
+
+    // a completed request can be submitted again
+    queue.submit(*requests[0]);
+    assert(queue.run() == 1);
+    assert(executed == 11);
+}
+
+// the future gets the result, or the exception
+void future_completion() {
+    teseo::teseo gps;
+    teseo::command_queue queue(gps);
+    std::future<bool> valid = queue.submit([](teseo::teseo&) -> bool { return true; });
+    std::future<bool> invalid = queue.submit([](teseo::teseo&) -> bool { return false; });
+    std::future<bool> thrown = queue.submit([](teseo::teseo&) -> bool { throw std::runtime_error("link"); });
+    assert(queue.run() == 3);
+    assert(valid.get());
+    assert(!invalid.get());
+    bool caught = false;
+    try {
+        thrown.get();
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    assert(caught);
+}
+
+// the callback gets the result. An exception from the work reaches it as false, and doesn't escape run()
+void callback_completion() {
+    teseo::teseo gps;
+    teseo::command_queue queue(gps);
+    int result = -1;
+    teseo::command_queue::request valid([](teseo::teseo&) -> bool { return true; },
+        [&result](bool r) -> void { result = r; });
+    queue.submit(valid);
+    assert(queue.run() == 1);
+    assert(result == 1);
+
+    teseo::command_queue::request thrown([](teseo::teseo&) -> bool { throw std::runtime_error("link"); },
+        [&result](bool r) -> void { result = r; });
+    queue.submit(thrown);
+    assert(queue.run() == 1);
+    assert(result == 0);
+}
+
+// requests still queued when the queue is destroyed are cancelled, without running their work
+void destroyed_with_pending() {
+    teseo::teseo gps;
+    bool worked = false;
+    int result = -1;
+    teseo::command_queue::request pending([&worked](teseo::teseo&) -> bool { worked = true; return true; },
+        [&result](bool r) -> void { result = r; });
+    std::future<bool> future;
+    {
+        teseo::command_queue queue(gps);
+        queue.submit(pending);
+        future = queue.submit([&worked](teseo::teseo&) -> bool { worked = true; return true; });
+    }
+    assert(!worked);
+    assert(result == 0);
+    bool broken = false;
+    try {
+        future.get();
+    } catch (const std::future_error& e) {
+        broken = e.code() == std::future_errc::broken_promise;
+    }
+    assert(broken);
+}
+
+} // namespace
+
+int main() {
+    many_producers();
+    batch();
+    future_completion();
+    callback_completion();
+    destroyed_with_pending();
+    std::puts("command_queue_test: passed");
+    return 0;
+}
@@ -0,0 +1,162 @@
+// host test for teseo::geodesy distances and the odometer, against reference geodesics (GeographicLib 2)
+// g++ -std=c++20 -Inmea -Igeodesy test/distance_test.cpp geodesy/distance.cpp -o distance_test && ./distance_test
+
+#undef NDEBUG
+#include "distance.h"
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+namespace geodesy = teseo::geodesy;
+
+bool near(double value, double expected, double tolerance) {
+    return std::fabs(value - expected) <= tolerance;
+}
+
+// inverse problems: start, end, geodesic distance and initial azimuth
+struct geodesic {
+    double latitude1;
+    double longitude1;
+    double latitude2;
+    double longitude2;
+    double distance;
+    double bearing;
+};
+
+constexpr std::array<geodesic, 4> converging {{
+    // Flinders Peak to Buninyong, Vincenty's own example
+    {-37.95103341666667, 144.42486788888888, -37.65282113888889, 143.92649552777777, 54972.2711, 306.86815920},
+    // Eiffel Tower to Sydney Opera House
+    {48.858370, 2.294481, -33.856784, 151.215297, 16960892.2652, 68.12145084},
+    {0.0, 0.0, 0.0, 90.0, 10018754.1714, 90.0},
+    {0.0, 0.0, 10.0, 0.0, 1105854.8332, 0.0},
+}};
+
+// nearly antipodal: Vincenty's iteration doesn't converge
+constexpr std::array<geodesic, 4> antipodal {{
+    {0.0, 0.0, 0.5, 179.7, 19944127.4208, 15.55688279},
+    {0.0, 0.0, 0.0, 179.9, 20003008.4215, 9.54567269},
+    {10.0, 0.0, -10.0, 179.8, 20000239.4377, 19.67757577},
+    {0.0, 0.0, 0.0, 179.5, 19980861.9089, 55.96649514},
+}};
+
+void vincenty() {
+    for (const geodesic& g : converging) {
+        double distance;
+        double bearing;
+        assert(geodesy::vincenty(g.latitude1, g.longitude1, g.latitude2, g.longitude2, distance, bearing));
+        assert(near(distance, g.distance, 0.001));
+        assert(near(bearing, g.bearing, 1e-6));
+    }
+    double distance = -1.0;
+    double bearing = -1.0;
+    assert(geodesy::vincenty(50.0, 4.0, 50.0, 4.0, distance, bearing));
+    assert(distance == 0.0);
+
+    for (const geodesic& g : antipodal) {
+        distance = -1.0;
+        assert(!geodesy::vincenty(g.latitude1, g.longitude1, g.latitude2, g.longitude2, distance, bearing));
+        // the fallback
+        assert(near(geodesy::haversine(g.latitude1, g.longitude1, g.latitude2, g.longitude2), g.distance, g.distance * 0.006));
+    }
+}
+
+void haversine() {
+    for (const geodesic& g : converging) {
+        assert(near(geodesy::haversine(g.latitude1, g.longitude1, g.latitude2, g.longitude2), g.distance, g.distance * 0.006));
+    }
+    assert(geodesy::haversine(50.0, 4.0, 50.0, 4.0) == 0.0);
+    // across the antimeridian
+    assert(near(geodesy::haversine(0.0, 179.9, 0.0, -179.9), geodesy::haversine(0.0, 0.0, 0.0, 0.2), 1e-6));
+}
+
+void bearing() {
+    assert(near(geodesy::bearing(0.0, 0.0, 10.0, 0.0), 0.0, 1e-9));
+    assert(near(geodesy::bearing(0.0, 0.0, 0.0, 10.0), 90.0, 1e-9));
+    assert(near(geodesy::bearing(10.0, 0.0, 0.0, 0.0), 180.0, 1e-9));
+    assert(near(geodesy::bearing(0.0, 10.0, 0.0, 0.0), 270.0, 1e-9));
+    // the great circle from Paris to Sydney: the sphere is within a degree of the ellipsoid
+    const geodesic& g = converging[1];
+    assert(near(geodesy::bearing(g.latitude1, g.longitude1, g.latitude2, g.longitude2), g.bearing, 1.0));
+}
+
+// the batches give the scalar results, and the shorter column or output limits them
+void batches() {
+    const std::array<double, 4> latitude {50.0, 50.001, 50.002, 50.003};
+    const std::array<double, 3> longitude {4.0, 4.001, 4.0}; // one short
+    std::array<double, 3> out {-1.0, -1.0, -1.0};
+    assert(geodesy::haversine(latitude, longitude, out) == 2);
+    assert(near(out[1], geodesy::haversine(latitude[1], longitude[1], latitude[2], longitude[2]), 1e-9));
+    assert(out[2] == -1.0);
+    assert(geodesy::bearing(latitude, longitude, std::span(out).first(1)) == 1);
+    assert(near(out[0], geodesy::bearing(latitude[0], longitude[0], latitude[1], longitude[1]), 1e-9));
+    assert(geodesy::haversine(std::span(latitude).first(1), longitude, out) == 0);
+
+    assert(near(geodesy::track_length(latitude, longitude), geodesy::haversine(latitude[0], longitude[0], latitude[1], longitude[1]) +
+        geodesy::haversine(latitude[1], longitude[1], latitude[2], longitude[2]), 1e-9));
+}
+
+void odometer() {
+    // along the meridian, 3 m steps: the sum is the great circle distance
+    geodesy::odometer trip;
+    constexpr int steps = 36000;
+    for (int i = 0; i <= steps; i++) {
+        trip.add(i / 36000.0, 4.0);
+    }
+    assert(trip.steps() == steps);
+    assert(near(trip.total(), geodesy::haversine(0.0, 4.0, 1.0, 4.0), 0.001));
+
+    // a month of 1 s steps, back and forth: no rounding drift
+    geodesy::odometer month;
+    const double step = geodesy::haversine(50.0, 4.0, 50.0001, 4.0);
+    constexpr unsigned long seconds = 31ul * 24 * 3600;
+    for (unsigned long i = 0; i <= seconds; i++) {
+        month.add(i % 2 ? 50.0001 : 50.0, 4.0);
+    }
+    assert(month.steps() == seconds);
+    assert(near(month.total(), seconds * step, 1e-6));
+
+    // standing still: the jitter stays below min_step_m
+    geodesy::odometer parked(5.0);
+    for (int i = 0; i < 1000; i++) {
+        parked.add(50.0 + (i % 3) * 0.00001, 4.0); // up to 2.2 m
+    }
+    assert(parked.total() == 0.0 && parked.steps() == 0);
+    assert(parked.add(50.001, 4.0) > 100.0);
+
+    // fixes without quality or status A don't count
+    teseo::nmea::gga gga {};
+    gga.latitude = 50.0;
+    gga.longitude = 4.0;
+    gga.quality = 1;
+    teseo::nmea::rmc rmc {};
+    rmc.latitude = 50.01;
+    rmc.longitude = 4.0;
+    rmc.valid = false;
+    geodesy::odometer fixes;
+    fixes.add(gga);
+    assert(fixes.add(rmc) == 0.0);
+    gga.latitude = 50.01;
+    gga.quality = 0;
+    assert(fixes.add(gga) == 0.0);
+    rmc.valid = true;
+    assert(near(fixes.add(rmc), geodesy::haversine(50.0, 4.0, 50.01, 4.0), 1e-9));
+    fixes.reset();
+    assert(fixes.total() == 0.0 && fixes.steps() == 0);
+    assert(fixes.add(rmc) == 0.0); // the new starting point
+}
+
+} // namespace
+
+int main() {
+    vincenty();
+    haversine();
+    bearing();
+    batches();
+    odometer();
+    std::puts("distance_test: passed");
+    return 0;
+}
@@ -0,0 +1,134 @@
+// host test for teseo::duty_cycle, with the simulator
+// g++ -std=c++20 -Icallbackmanager -Iteseo -Isimulator test/duty_cycle_test.cpp teseo/teseo.cpp teseo/duty_cycle.cpp -o duty_cycle_test && ./duty_cycle_test
+
+#undef NDEBUG
+#include "duty_cycle.h"
+#include "simulator.h"
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+// a Teseo simulator, with the commands that the controller sent, and a clock that ticks every 100 ms
+struct rig {
+    teseo::simulator sim;
+    teseo::teseo gps;
+    teseo::duty_cycle cycle;
+    std::vector<std::string> commands;
+    std::string gga;
+    uint64_t now = 0;
+
+    rig(uint32_t period_ms, uint32_t wake_lead_ms, uint32_t fix_timeout_ms, unsigned int hot_start_polls) :
+            cycle(gps, period_ms, wake_lead_ms, fix_timeout_ms) {
+        sim.hot_start_requests() = hot_start_polls;
+        gps.writer().set([this](const std::string& s) -> void { commands.push_back(s); sim.write(s); });
+        gps.reader().set([this](std::string& s) -> void { sim.read(s); });
+    }
+
+    // tick until a fix or a miss, and return the time of the tick that took the fix. 0 for a miss
+    uint64_t next_period() {
+        const teseo::duty_cycle::report before = cycle.statistics();
+        while (true) {
+            now += 100;
+            if (cycle.tick(now, gga)) {
+                return now;
+            }
+            if (cycle.statistics().misses != before.misses) {
+                return 0;
+            }
+        }
+    }
+};
+
+// the first tick polls at once, takes the fix and puts the Teseo in standby until wake_lead_ms before the next one
+void first_fix() {
+    rig r(60000, 2000, 30000, 0);
+    assert(r.cycle.tick(0, r.gga));
+    assert(r.gga.starts_with("$GPGGA,"));
+    assert(r.cycle.statistics().fixes == 1);
+    assert(r.cycle.statistics().wake_to_fix_ms == 0);
+    assert(r.commands.size() == 2);
+    assert(r.commands[0].starts_with("$PSTMNMEAREQUEST,"));
+    assert(r.commands[1] == "$PSTMFORCESTANDBY,00058\r\n");
+    assert(r.sim.standbys() == 1);
+}
+
+// in standby, tick() doesn't talk to the Teseo. It wakes wake_lead_ms before the fix is due
+void standby_until_wake() {
+    rig r(60000, 2000, 30000, 0);
+    r.cycle.tick(0, r.gga);
+    r.commands.clear();
+    for (r.now = 100; r.now < 58000; r.now += 100) {
+        assert(!r.cycle.tick(r.now, r.gga));
+    }
+    assert(r.commands.empty());
+    assert(r.cycle.tick(58000, r.gga));
+    assert(r.commands.size() == 2);
+    assert(r.cycle.statistics().fixes == 2);
+}
+
+// after the standby, the hot start reports no fix for a while: wake-to-fix and on-time measure it
+void hot_start() {
+    rig r(60000, 2000, 30000, 15);
+    assert(r.next_period() == 100); // the Teseo was not in standby
+    r.commands.clear();
+    // due at 60100, wake at 58100, 15 polls without fix
+    assert(r.next_period() == 58100 + 1500);
+    const teseo::duty_cycle::report& report = r.cycle.statistics();
+    assert(report.fixes == 2);
+    assert(report.misses == 0);
+    assert(report.wake_to_fix_ms == 1500);
+    assert(report.on_time_ms == 1500);
+    assert(report.total_on_time_ms == 1500);
+    assert(r.commands.size() == 15 + 1 + 1); // polls without fix, the poll with fix, standby
+}
+
+// without a fix before fix_timeout_ms, the period is a miss, and the Teseo sleeps until the next one
+void fix_timeout() {
+    rig r(60000, 2000, 5000, 1000);
+    assert(r.next_period() == 100);
+    assert(r.next_period() == 0); // wake at 58100, give up at 63100
+    assert(r.cycle.statistics().misses == 1);
+    assert(r.cycle.statistics().on_time_ms == 5000);
+    assert(r.commands.back() == "$PSTMFORCESTANDBY,00055\r\n"); // due at 120100, wake at 118100
+    assert(r.next_period() == 0);
+    assert(r.now == 123100);
+    assert(r.cycle.statistics().misses == 2);
+    assert(r.cycle.statistics().fixes == 1);
+}
+
+// a fix that takes longer than the period skips the missed periods, and the standby that would be too short
+void overrun() {
+    rig r(2000, 1000, 30000, 30);
+    assert(r.next_period() == 100);
+    assert(r.next_period() == 1100 + 3000); // due at 2100, wake at 1100, 30 polls without fix
+    // the fix due at 4100 is skipped: the next one is due at 6100, wake at 5100
+    assert(r.commands.back() == "$PSTMFORCESTANDBY,00001\r\n");
+    const std::size_t commands = r.commands.size();
+    for (r.now = 4200; r.now < 5100; r.now += 100) {
+        assert(!r.cycle.tick(r.now, r.gga));
+    }
+    assert(r.commands.size() == commands);
+    r.cycle.tick(5100, r.gga);
+    assert(r.commands.size() == commands + 1);
+
+    rig fast(1500, 1000, 30000, 0);
+    assert(fast.cycle.tick(0, fast.gga));
+    // due at 1500, wake at 500: too short for the Teseo's 1 s resolution, no standby
+    assert(fast.commands.size() == 1);
+    assert(fast.sim.standbys() == 0);
+}
+
+} // namespace
+
+int main() {
+    first_fix();
+    standby_until_wake();
+    hot_start();
+    fix_timeout();
+    overrun();
+    std::puts("duty_cycle_test: passed");
+    return 0;
+}
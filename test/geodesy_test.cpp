@@ -0,0 +1,109 @@
+// host test for teseo::geodesy transforms, against reference points (PROJ 9)
+// g++ -std=c++20 -Inmea -Igeodesy test/geodesy_test.cpp geodesy/geodesy.cpp -o geodesy_test && ./geodesy_test
+
+#undef NDEBUG
+#include "geodesy.h"
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+namespace geodesy = teseo::geodesy;
+
+struct point {
+    double latitude;
+    double longitude;
+    double height;
+};
+
+constexpr point eiffel_tower {48.858370, 2.294481, 330.0};
+constexpr point opera_house {-33.856784, 151.215297, 5.0};
+
+bool near(double value, double expected, double tolerance) {
+    return std::fabs(value - expected) <= tolerance;
+}
+
+void ecef() {
+    geodesy::ecef p = geodesy::to_ecef(eiffel_tower.latitude, eiffel_tower.longitude, eiffel_tower.height);
+    assert(near(p.x, 4201155.3250, 0.001) && near(p.y, 168330.5020, 0.001) && near(p.z, 4780459.3656, 0.001));
+    p = geodesy::to_ecef(opera_house.latitude, opera_house.longitude, opera_house.height);
+    assert(near(p.x, -4646973.0093, 0.001) && near(p.y, 2553079.6389, 0.001) && near(p.z, -3533268.4393, 0.001));
+    // on the axes: the semi-major and the semi-minor axis
+    p = geodesy::to_ecef(0.0, 0.0, 0.0);
+    assert(near(p.x, 6378137.0, 0.001) && near(p.y, 0.0, 0.001) && near(p.z, 0.0, 0.001));
+    p = geodesy::to_ecef(90.0, 0.0, 0.0);
+    assert(near(p.x, 0.0, 0.001) && near(p.y, 0.0, 0.001) && near(p.z, 6356752.3142, 0.001));
+
+    // a GGA fix: height above the ellipsoid is altitude + geoid separation
+    teseo::nmea::gga fix {};
+    fix.latitude = eiffel_tower.latitude;
+    fix.longitude = eiffel_tower.longitude;
+    fix.altitude = 285.0f;
+    fix.geoid_separation = 45.0f;
+    p = geodesy::to_ecef(fix);
+    assert(near(p.x, 4201155.3250, 0.001) && near(p.z, 4780459.3656, 0.001));
+}
+
+void utm() {
+    geodesy::utm u = geodesy::to_utm(eiffel_tower.latitude, eiffel_tower.longitude);
+    assert(u.zone == 31 && u.north);
+    assert(near(u.easting, 448250.5768, 0.001) && near(u.northing, 5411951.5880, 0.001));
+    u = geodesy::to_utm(opera_house.latitude, opera_house.longitude);
+    assert(u.zone == 56 && !u.north);
+    assert(near(u.easting, 334900.2613, 0.001) && near(u.northing, 6252290.5224, 0.001));
+    // in the next zone, 3.5 degrees from the central meridian
+    u = geodesy::to_utm(eiffel_tower.latitude, 6.5, 31);
+    assert(u.zone == 31);
+    assert(near(u.easting, 756702.5687, 0.001) && near(u.northing, 5417619.6771, 0.001));
+    // Bergen is in the widened zone 32
+    u = geodesy::to_utm(60.3913, 5.3221);
+    assert(u.zone == 32);
+    assert(near(u.easting, 297353.9327, 0.001) && near(u.northing, 6700648.3452, 0.001));
+
+    assert(geodesy::utm_zone(78.22, 15.65) == 33); // Longyearbyen, Svalbard
+    assert(geodesy::utm_zone(0.0, -180.0) == 1);
+    assert(geodesy::utm_zone(0.0, 179.9) == 60);
+}
+
+// the batches give the scalar results, and a short span limits the batch
+void batches() {
+    const std::array<double, 3> latitude {eiffel_tower.latitude, eiffel_tower.latitude + 0.001, eiffel_tower.latitude};
+    const std::array<double, 3> longitude {eiffel_tower.longitude, eiffel_tower.longitude, eiffel_tower.longitude + 0.001};
+    const std::array<float, 2> height {330.0f, 330.0f}; // one short
+    std::array<double, 3> x {-1.0, -1.0, -1.0};
+    std::array<double, 3> y {-1.0, -1.0, -1.0};
+    std::array<double, 3> z {-1.0, -1.0, -1.0};
+    const geodesy::columns out {x, y, z};
+
+    assert(geodesy::to_ecef(latitude, longitude, height, out) == 2);
+    const geodesy::ecef p = geodesy::to_ecef(latitude[1], longitude[1], 330.0);
+    assert(near(x[1], p.x, 1e-6) && near(y[1], p.y, 1e-6) && near(z[1], p.z, 1e-6));
+    assert(x[2] == -1.0 && y[2] == -1.0 && z[2] == -1.0);
+
+    const geodesy::local_frame frame(eiffel_tower.latitude, eiffel_tower.longitude, eiffel_tower.height);
+    assert(frame.to_enu(latitude, longitude, height, geodesy::columns {x, y, std::span(z).first(1)}) == 1);
+    assert(near(x[0], 0.0, 1e-6) && near(y[0], 0.0, 1e-6) && near(z[0], 0.0, 1e-6));
+    assert(frame.to_enu(latitude, longitude, height, out) == 2);
+    assert(near(x[1], 0.0, 0.001) && near(y[1], 111.2, 0.1) && near(z[1], 0.0, 0.01)); // 0.001 degree north
+    const geodesy::enu e = frame.to_enu(latitude[1], longitude[1], 330.0);
+    assert(near(x[1], e.east, 1e-9) && near(y[1], e.north, 1e-9) && near(z[1], e.up, 1e-9));
+
+    std::array<double, 2> easting {-1.0, -1.0};
+    std::array<double, 3> northing {-1.0, -1.0, -1.0};
+    assert(geodesy::to_utm(latitude, longitude, 31, easting, northing) == 2);
+    const geodesy::utm u = geodesy::to_utm(latitude[1], longitude[1], 31);
+    assert(near(easting[1], u.easting, 1e-6) && near(northing[1], u.northing, 1e-6));
+    assert(northing[2] == -1.0);
+}
+
+} // namespace
+
+int main() {
+    ecef();
+    utm();
+    batches();
+    std::puts("geodesy_test: passed");
+    return 0;
+}
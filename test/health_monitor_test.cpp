@@ -0,0 +1,145 @@
+// host test for teseo::health_monitor
+// g++ -std=c++20 -Icallbackmanager -Iteseo test/health_monitor_test.cpp teseo/teseo.cpp teseo/health_monitor.cpp -o health_monitor_test && ./health_monitor_test
+
+#undef NDEBUG
+#include "health_monitor.h"
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+const std::string gga = "$GPGGA,120000.000,5051.00000,N,00426.00000,E,1,07,1.2,70.0,M,47.0,M,,*6E\r\n";
+const std::string gga_status = "$PSTMNMEAREQUEST,2,0\r\n";
+
+// a Teseo that replies well, without status line, or not at all. It polls and ticks once a second
+struct rig {
+    enum class reply { valid, no_status, none };
+
+    teseo::teseo gps;
+    teseo::health_monitor monitor;
+    reply mode = reply::valid;
+    uint64_t now = 0;
+    uint64_t resync_at = 0;
+    uint64_t reset_at = 0;
+    uint64_t failed_at = 0;
+    unsigned int resyncs = 0;
+    unsigned int resets = 0;
+
+    rig(const teseo::health_limits& limits) : monitor(gps, limits) {
+        gps.writer().set([](const std::string&) -> void {});
+        gps.reader().set([this](std::string& s) -> void {
+            s = mode == reply::valid ? gga + gga_status : mode == reply::no_status ? gga : "";
+        });
+        monitor.resync().set([this]() -> void { resyncs++; resync_at = now; });
+        monitor.reset().set([this]() -> void { resets++; reset_at = now; });
+        monitor.failed().set([this]() -> void { failed_at = now; });
+        monitor.tick(now); // start the timeouts and the window
+    }
+
+    teseo::health_monitor::level poll() {
+        now += 1000;
+        std::string s;
+        gps.ask_gga(s);
+        return monitor.tick(now);
+    }
+};
+
+// the failure rate limits, not the reply timeout
+teseo::health_limits window_only() {
+    teseo::health_limits limits;
+    limits.reply_timeout_ms = 3600000;
+    return limits;
+}
+
+// a window without status lines escalates: resync, reset escalation_ms later, failed escalation_ms after that
+void escalation() {
+    using level = teseo::health_monitor::level;
+    rig r(window_only());
+    r.mode = rig::reply::no_status;
+    for (int i = 1; i < 10; i++) {
+        assert(r.poll() == level::healthy); // the window isn't complete
+    }
+    assert(r.poll() == level::resync);
+    assert(r.resyncs == 1 && r.resync_at == 10000);
+    while (r.now < 19000) {
+        assert(r.poll() == level::resync);
+    }
+    assert(r.poll() == level::reset);
+    assert(r.reset_at == 20000);
+    while (r.now < 30000) {
+        r.poll();
+    }
+    assert(r.monitor.state() == level::failed);
+    assert(r.failed_at == 30000);
+    r.poll();
+    assert(r.resyncs == 1 && r.resets == 1);
+}
+
+// after a resync, half a window of valid replies clears the unhealthy window
+void recovery_clears_window() {
+    using level = teseo::health_monitor::level;
+    rig r(window_only());
+    r.mode = rig::reply::no_status;
+    for (int i = 0; i < 10; i++) {
+        r.poll();
+    }
+    assert(r.monitor.state() == level::resync);
+    r.mode = rig::reply::valid; // the resync worked
+    for (int i = 1; i < 5; i++) {
+        assert(r.poll() == level::resync);
+    }
+    assert(r.poll() == level::healthy);
+    for (int i = 0; i < 20; i++) {
+        assert(r.poll() == level::healthy);
+    }
+    assert(r.resyncs == 1 && r.resets == 0);
+
+    // a half window that still fails keeps the verdict: reset follows
+    r.mode = rig::reply::no_status;
+    while (r.monitor.state() == level::healthy) {
+        r.poll();
+    }
+    const uint64_t resync_at = r.resync_at;
+    r.mode = rig::reply::valid;
+    r.poll();
+    r.mode = rig::reply::no_status;
+    while (r.monitor.state() == level::resync) {
+        r.poll();
+    }
+    assert(r.monitor.state() == level::reset);
+    assert(r.reset_at == resync_at + 10000);
+}
+
+// without any reply, the reply timeout escalates. The replies that didn't come made the window unhealthy too:
+// half a window of valid replies is healthy again
+void reply_timeout() {
+    using level = teseo::health_monitor::level;
+    rig r(teseo::health_limits {});
+    r.poll();
+    r.mode = rig::reply::none;
+    while (r.monitor.state() == level::healthy) {
+        r.poll();
+    }
+    assert(r.resync_at == 7000); // last valid reply at 1000, more than 5 s without
+    while (r.monitor.state() != level::failed) {
+        r.poll();
+    }
+    assert(r.reset_at == 17000 && r.failed_at == 27000);
+    assert(r.gps.statistics().status_failures == 0); // no reply is not a missing status line
+    r.mode = rig::reply::valid;
+    for (int i = 1; i < 5; i++) {
+        assert(r.poll() == level::failed);
+    }
+    assert(r.poll() == level::healthy);
+}
+
+} // namespace
+
+int main() {
+    escalation();
+    recovery_clears_window();
+    reply_timeout();
+    std::puts("health_monitor_test: passed");
+    return 0;
+}
@@ -0,0 +1,123 @@
+// host test for teseo::hybrid
+// g++ -std=c++20 -Icallbackmanager -Iteseo -Inmea test/hybrid_test.cpp teseo/hybrid.cpp teseo/teseo.cpp nmea/nmea.cpp -o hybrid_test && ./hybrid_test
+
+#undef NDEBUG
+#include "hybrid.h"
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <array>
+
+namespace {
+
+const std::string streamed_gga = "$GPGGA,120000.000,5051.00000,N,00426.00000,E,1,07,1.2,70.0,M,47.0,M,,*6E\r\n";
+const std::string polled_gga = "$GPGGA,120001.000,5051.00010,N,00426.00010,E,1,07,1.2,70.0,M,47.0,M,,*6F\r\n";
+const std::string gga_status = "$PSTMNMEAREQUEST,2,0\r\n";
+
+// a GGA that was streamed just before the polled one is not the reply
+void streamed_line_ignored() {
+    std::string data;
+    teseo::teseo gps;
+    gps.writer().set([&data](const std::string&) -> void { data = streamed_gga + polled_gga + gga_status; });
+    gps.reader().set([&data](std::string& s) -> void { s = data; data.clear(); });
+    teseo::hybrid link(gps);
+    unsigned int delivered = 0;
+    link.subscriber().set([&delivered](std::string_view) -> void { delivered++; });
+
+    std::string s;
+    assert(link.ask<teseo::sentence::gga>(s));
+    assert(s == polled_gga);
+    assert(delivered == 2); // both are still handed to the subscriber
+    assert(gps.statistics().requests == 1);
+    assert(gps.statistics().valid_replies == 1);
+    assert(gps.statistics().fixes == 1);
+}
+
+// a streamed GSV group before the polled one is replaced by it
+void streamed_group_ignored() {
+    const std::string gsv_status = "$PSTMNMEAREQUEST,80000,0\r\n";
+    const std::string streamed = "$GPGSV,2,1,05,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*70\r\n"
+        "$GPGSV,2,2,05,14,25,170,00*48\r\n";
+    const std::string polled = "$GPGSV,3,1,09,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*7D\r\n"
+        "$GPGSV,3,2,09,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00*7D\r\n"
+        "$GPGSV,3,3,09,22,42,067,42*41\r\n";
+    std::string data;
+    teseo::teseo gps;
+    gps.writer().set([&](const std::string&) -> void { data = streamed + polled + gsv_status; });
+    gps.reader().set([&data](std::string& s) -> void { s = data; data.clear(); });
+    teseo::hybrid link(gps);
+
+    std::array<std::string, 8> strings;
+    unsigned int count;
+    assert(link.ask<teseo::sentence::gsv>(strings, count));
+    assert(count == 3);
+    assert(strings[0].starts_with("$GPGSV,3,1,"));
+    assert(strings[2].starts_with("$GPGSV,3,3,"));
+    assert(strings[3].empty());
+}
+
+// a poll without status line is counted as a status failure
+void missing_status_counted() {
+    teseo::teseo gps;
+    gps.writer().set([](const std::string&) -> void {});
+    gps.reader().set([](std::string& s) -> void { s = streamed_gga; });
+    teseo::hybrid link(gps);
+
+    std::string s;
+    assert(!link.ask<teseo::sentence::gga>(s));
+    assert(link.statistics().incomplete == 1);
+    assert(gps.statistics().invalid_replies == 1);
+    assert(gps.statistics().status_failures == 1);
+}
+
+// a poll that gets no reply at all is invalid, but not a status failure
+void no_reply_not_status_failure() {
+    teseo::teseo gps;
+    gps.writer().set([](const std::string&) -> void {});
+    gps.reader().set([](std::string& s) -> void { s.clear(); });
+    teseo::hybrid link(gps);
+
+    std::string s;
+    assert(!link.ask<teseo::sentence::gga>(s));
+    assert(link.statistics().incomplete == 1);
+    assert(gps.statistics().invalid_replies == 1);
+    assert(gps.statistics().status_failures == 0);
+}
+
+// a sentence that was streamed and polled, with the same type and UTC time, is handed to the subscriber once
+void duplicate_delivered_once() {
+    const std::string no_time = "$GPGGA,,,,,,0,00,99.0,,M,,M,,*78\r\n";
+    std::string data;
+    teseo::teseo gps;
+    gps.writer().set([&data](const std::string&) -> void { data = streamed_gga + streamed_gga + gga_status; });
+    gps.reader().set([&data](std::string& s) -> void { s = data; data.clear(); });
+    teseo::hybrid link(gps);
+    unsigned int delivered = 0;
+    link.subscriber().set([&delivered](std::string_view) -> void { delivered++; });
+
+    std::string s;
+    assert(link.ask<teseo::sentence::gga>(s));
+    assert(s == streamed_gga);
+    assert(delivered == 1);
+    assert(link.statistics().duplicates == 1);
+
+    // without time, or with a bad checksum, there is nothing to compare
+    std::string corrupt = polled_gga;
+    corrupt[corrupt.length() - 3] = '0';
+    data = no_time + no_time + corrupt + corrupt;
+    link.pump();
+    assert(delivered == 1 + 4);
+    assert(link.statistics().duplicates == 1);
+}
+
+} // namespace
+
+int main() {
+    streamed_line_ignored();
+    streamed_group_ignored();
+    missing_status_counted();
+    no_reply_not_status_failure();
+    duplicate_delivered_once();
+    std::puts("hybrid_test: passed");
+    return 0;
+}
@@ -0,0 +1,210 @@
+// host test for teseo::journal, with a simulated NOR flash that loses power
+// g++ -std=c++20 -Icallbackmanager -Inmea -Ijournal test/journal_test.cpp -o journal_test && ./journal_test
+
+#undef NDEBUG
+#include "journal.h"
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+namespace {
+
+using log_type = teseo::journal<256>;
+constexpr log_type::geometry layout {.sector_size = 1024, .sectors = 4};
+
+struct power_loss {};
+
+// NOR flash: programming can only clear bits, erasing sets a sector to 0xFF.
+// The operation number cut_at is interrupted: half of it is done, or none of it, then power_loss is thrown
+struct nor {
+    std::vector<uint8_t> bytes = std::vector<uint8_t>(layout.sector_size * layout.sectors, 0xFF);
+    unsigned long operations = 0;
+    unsigned long cut_at = ULONG_MAX;
+    bool half = false;
+    // records whose page was programmed completely, and whose sector was not erased since: utc_ms, sector
+    std::map<uint32_t, uint32_t> durable;
+
+    void attach(log_type& log) {
+        log.program().set([this](uint32_t address, std::span<const uint8_t> page) -> void { program(address, page); });
+        log.erase().set([this](uint32_t address) -> void { erase(address); });
+        log.read().set([this](uint32_t address, std::span<uint8_t> data) -> void {
+            std::memcpy(data.data(), bytes.data() + address, data.size());
+        });
+    }
+
+    // how much of this operation is done
+    std::size_t cut(std::size_t size) {
+        if (operations++ != cut_at) {
+            return size;
+        }
+        return half ? size / 2 : 0;
+    }
+
+    void program(uint32_t address, std::span<const uint8_t> page) {
+        const std::size_t done = cut(page.size());
+        for (std::size_t i = 0; i < done; i++) {
+            bytes[address + i] &= page[i];
+        }
+        if (done < page.size()) {
+            throw power_loss();
+        }
+        if (address % layout.sector_size == 0) {
+            return; // the header page
+        }
+        for (std::size_t slot = 0; slot < page.size(); slot += sizeof(log_type::record)) {
+            log_type::record r;
+            std::memcpy(&r, page.data() + slot, sizeof(r));
+            if (r.sequence != 0xFFFFFFFF) {
+                durable[r.utc_ms] = address / layout.sector_size;
+            }
+        }
+    }
+
+    void erase(uint32_t address) {
+        const std::size_t done = cut(layout.sector_size);
+        std::fill_n(bytes.begin() + address, done, 0xFF);
+        std::erase_if(durable, [address](const auto& d) { return d.second == address / layout.sector_size; });
+        if (done < layout.sector_size) {
+            throw power_loss();
+        }
+    }
+};
+
+log_type::record fix(uint32_t utc_ms) {
+    log_type::record r {};
+    r.utc_ms = utc_ms;
+    r.quality = 1;
+    return r;
+}
+
+// append count records with utc_ms first.., flushing now and then. Returns false on power loss
+bool fill(log_type& log, uint32_t first, uint32_t count) {
+    try {
+        for (uint32_t i = 0; i < count; i++) {
+            log.append(fix(first + i));
+            if (i % 13 == 12) {
+                log.flush();
+            }
+        }
+        log.flush();
+    } catch (const power_loss&) {
+        return false;
+    }
+    return true;
+}
+
+std::vector<log_type::record> replay(log_type& log) {
+    std::vector<log_type::record> records;
+    log.replay([&records](const log_type::record& r) -> void { records.push_back(r); });
+    return records;
+}
+
+// power is lost at every write and erase, before it and half way. After recover(), replay() has every record
+// that was programmed completely and not erased since, in order, and appending goes on after the newest one
+void power_cut_everywhere() {
+    constexpr uint32_t appended = 200;
+    unsigned long operations;
+    {
+        nor flash;
+        log_type log(layout);
+        flash.attach(log);
+        assert(!log.recover());
+        assert(fill(log, 0, appended));
+        operations = flash.operations;
+    }
+
+    for (unsigned long cut_at = 0; cut_at < operations; cut_at++) {
+        for (bool half : {false, true}) {
+            nor flash;
+            flash.cut_at = cut_at;
+            flash.half = half;
+            {
+                log_type log(layout);
+                flash.attach(log);
+                bool recovered = true;
+                try {
+                    log.recover(); // erases and writes a header: operations 0 and 1
+                } catch (const power_loss&) {
+                    recovered = false;
+                }
+                assert(!recovered || !fill(log, 0, appended));
+            }
+
+            log_type log(layout);
+            flash.attach(log);
+            log.recover();
+            std::vector<log_type::record> records = replay(log);
+            for (std::size_t i = 1; i < records.size(); i++) {
+                assert(records[i].utc_ms == records[i - 1].utc_ms + 1);
+                assert(records[i].sequence > records[i - 1].sequence);
+            }
+            for (const auto& [utc_ms, sector] : flash.durable) {
+                assert(!records.empty() && records.front().utc_ms <= utc_ms && utc_ms <= records.back().utc_ms);
+            }
+            if (!records.empty()) {
+                assert(records.back().utc_ms < appended);
+            }
+
+            // the journal goes on after the power loss
+            assert(fill(log, 1000, 30));
+            std::vector<log_type::record> after = replay(log);
+            assert(after.size() >= 30);
+            for (std::size_t i = 1; i < after.size(); i++) {
+                assert(after[i].sequence > after[i - 1].sequence);
+            }
+            for (uint32_t i = 0; i < 30; i++) {
+                assert(after[after.size() - 30 + i].utc_ms == 1000 + i);
+            }
+        }
+    }
+}
+
+// a sector gets its header with the erase, before any record: after a power loss right then, it is the newest
+void header_with_erase() {
+    nor flash;
+    log_type log(layout);
+    flash.attach(log);
+    log.recover(); // erases and writes the header of sector 0
+    assert(log.statistics().erases == 1);
+    assert(log.statistics().pages_written == 1);
+
+    log_type after(layout);
+    flash.attach(after);
+    assert(after.recover());
+    assert(after.statistics().erases == 0);
+    assert(after.erase_count() == 1);
+    assert(replay(after).empty());
+}
+
+// the erase counts go up one per erase of a sector, also after recover()
+void wear() {
+    nor flash;
+    {
+        log_type log(layout);
+        flash.attach(log);
+        log.recover();
+        // (pages - header) * slots records per sector: fill each sector twice. Sector 0 is erased a third time
+        for (uint32_t i = 0; i < 2 * layout.sectors * 3 * 8; i++) {
+            log.append(fix(i));
+        }
+        assert(log.statistics().erases == 2 * layout.sectors + 1);
+        assert(log.erase_count() == 3);
+    }
+    log_type log(layout);
+    flash.attach(log);
+    assert(log.recover());
+    assert(log.erase_count() == 3);
+    assert(replay(log).back().utc_ms == 2 * layout.sectors * 3 * 8 - 1);
+}
+
+} // namespace
+
+int main() {
+    power_cut_everywhere();
+    header_with_erase();
+    wear();
+    std::puts("journal_test: passed");
+    return 0;
+}
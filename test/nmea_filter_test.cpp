@@ -0,0 +1,76 @@
+// host test for teseo::nmea_filter
+// g++ -std=c++20 -Icallbackmanager -Iteseo test/nmea_filter_test.cpp teseo/teseo.cpp -o nmea_filter_test && ./nmea_filter_test
+
+#undef NDEBUG
+#include "teseo.h"
+#include <array>
+#include <cassert>
+#include <cstdio>
+#include <string_view>
+
+namespace {
+
+constexpr std::string_view gga_gps = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+constexpr std::string_view gga_dgps = "$GNGGA,123519,4807.038,N,01131.000,E,2,08,0.9,545.4,M,46.9,M,,*59\r\n";
+constexpr std::string_view gga_no_fix = "$GPGGA,123519,,,,,0,00,99.9,,,,,,*6E\r\n";
+constexpr std::string_view gga_empty = "$GPGGA,,,,,,,,,,,,,,*56\r\n";
+constexpr std::string_view gga_short = "$GPGGA,123519,4807.038,N";
+constexpr std::string_view gsv = "$GLGSV,1,1,03,65,48,034,38,72,22,300,31,88,61,112,40*50\r\n";
+
+// an empty filter accepts all
+void accept_all() {
+    const teseo::nmea_filter all;
+    assert(all.accept(gga_gps));
+    assert(all.accept(gga_no_fix));
+    assert(all.accept(gga_short));
+    assert(all.accept(gsv));
+}
+
+void talkers_and_sentences() {
+    static constexpr std::array<std::string_view, 2> gps_and_gnss {"GP", "GN"};
+    static constexpr std::array<std::string_view, 1> gga {"GGA"};
+    const teseo::nmea_filter by_talker {.talkers = gps_and_gnss};
+    assert(by_talker.accept(gga_gps));
+    assert(by_talker.accept(gga_dgps));
+    assert(!by_talker.accept(gsv));
+
+    const teseo::nmea_filter by_sentence {.sentences = gga};
+    assert(by_sentence.accept(gga_gps));
+    assert(!by_sentence.accept(gsv));
+
+    // both have to match
+    static constexpr std::array<std::string_view, 1> glonass {"GL"};
+    const teseo::nmea_filter glonass_gga {.talkers = glonass, .sentences = gga};
+    assert(!glonass_gga.accept(gga_gps));
+    assert(!glonass_gga.accept(gsv));
+}
+
+// min_quality checks GGA field 6 only, and rejects a GGA without quality
+void min_quality() {
+    const teseo::nmea_filter has_fix {.min_quality = 1};
+    assert(has_fix.accept(gga_gps));
+    assert(has_fix.accept(gga_dgps));
+    assert(!has_fix.accept(gga_no_fix));
+    assert(!has_fix.accept(gga_empty));
+    assert(!has_fix.accept(gga_short));
+    assert(has_fix.accept(gsv));
+
+    const teseo::nmea_filter differential {.min_quality = 2};
+    assert(!differential.accept(gga_gps));
+    assert(differential.accept(gga_dgps));
+
+    static constexpr std::array<std::string_view, 1> glonass {"GL"};
+    const teseo::nmea_filter glonass_with_fix {.talkers = glonass, .min_quality = 1};
+    assert(!glonass_with_fix.accept(gga_gps));
+    assert(glonass_with_fix.accept(gsv));
+}
+
+} // namespace
+
+int main() {
+    accept_all();
+    talkers_and_sentences();
+    min_quality();
+    std::puts("nmea_filter_test: passed");
+    return 0;
+}
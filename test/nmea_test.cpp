@@ -0,0 +1,132 @@
+// host test for the NMEA decoders and encoders
+// g++ -std=c++20 -Inmea test/nmea_test.cpp nmea/nmea.cpp -o nmea_test && ./nmea_test
+
+#undef NDEBUG
+#include "nmea.h"
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <string_view>
+
+namespace {
+
+constexpr std::string_view gga = "$GPGGA,123519.000,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*59\r\n";
+constexpr std::string_view rmc = "$GPRMC,123519.000,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*74\r\n";
+
+// decode_batch stays within the shortest column, and within the device list
+void batch_mismatched_spans() {
+    const std::array<std::string_view, 4> lines {gga, rmc, gga, rmc};
+    const std::array<uint32_t, 4> devices {7, 8, 9, 10};
+
+    // guard values after each column catch a write past its end
+    std::array<uint32_t, 5> utc_ms;
+    std::array<double, 5> latitude;
+    std::array<double, 3> longitude; // shortest: 2 rows, and a guard
+    std::array<float, 5> speed_knots;
+    std::array<uint8_t, 5> quality;
+    std::array<uint32_t, 5> device;
+    longitude.fill(-1.0);
+    const teseo::nmea::fix_columns out {
+        .utc_ms = std::span(utc_ms).first(4),
+        .latitude = std::span(latitude).first(4),
+        .longitude = std::span(longitude).first(2),
+        .speed_knots = std::span(speed_knots).first(4),
+        .quality = std::span(quality).first(4),
+        .device = std::span(device).first(4)};
+    assert(teseo::nmea::decode_batch(lines, devices, out) == 2);
+    assert(longitude[2] == -1.0);
+    assert(device[0] == 7 && device[1] == 8);
+
+    // fewer device indexes than lines
+    longitude.fill(-1.0);
+    const teseo::nmea::fix_columns wide {utc_ms, latitude, longitude, speed_knots, quality, device};
+    assert(teseo::nmea::decode_batch(lines, std::span(devices).first(1), wide) == 1);
+    assert(device[0] == 7 && longitude[1] == -1.0);
+}
+
+// sentences as the Teseo sends them: encode() of the decoded data gives the same bytes
+constexpr std::array<std::string_view, 6> teseo_format {
+    "$GPGGA,123519.000,3351.40200,S,07030.00000,W,1,07,1.2,70.0,M,47.0,M,,*68\r\n",
+    "$GPGGA,123519.000,,,,,0,00,99.0,,M,,M,,*6B\r\n",
+    "$GPRMC,123519.000,A,3351.40200,S,07030.00000,W,022.4,084.4,230394,003.1,W*7F\r\n",
+    "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48\r\n",
+    "$GPGLL,3351.40200,S,07030.00000,W,123519.000,A,A*5D\r\n",
+    "$GPGLL,4807.03800,N,01131.00000,E,123519.000,V,N*4E\r\n",
+};
+
+template <typename T>
+std::string_view round_trip(std::string_view line, std::span<char> buffer) {
+    T data;
+    assert(teseo::nmea::decode(line, data));
+    return std::string_view(buffer.data(), teseo::nmea::encode(data, buffer));
+}
+
+void encode_round_trip() {
+    std::array<char, teseo::nmea::max_sentence_length> buffer;
+    assert(round_trip<teseo::nmea::gga>(teseo_format[0], buffer) == teseo_format[0]);
+    assert(round_trip<teseo::nmea::gga>(teseo_format[1], buffer) == teseo_format[1]);
+    assert(round_trip<teseo::nmea::rmc>(teseo_format[2], buffer) == teseo_format[2]);
+    assert(round_trip<teseo::nmea::vtg>(teseo_format[3], buffer) == teseo_format[3]);
+    assert(round_trip<teseo::nmea::gll>(teseo_format[4], buffer) == teseo_format[4]);
+    assert(round_trip<teseo::nmea::gll>(teseo_format[5], buffer) == teseo_format[5]);
+
+    // other precisions decode to the same values after the round trip
+    teseo::nmea::rmc in;
+    teseo::nmea::rmc out;
+    assert(teseo::nmea::decode(rmc, in));
+    assert(teseo::nmea::decode(std::string_view(buffer.data(), teseo::nmea::encode(in, buffer)), out));
+    assert(std::fabs(out.latitude - in.latitude) < 1e-9 && std::fabs(out.longitude - in.longitude) < 1e-9);
+    assert(out.utc_ms == in.utc_ms && out.date == in.date && out.valid == in.valid);
+    assert(out.speed_knots == in.speed_knots && out.course == in.course);
+    assert(out.magnetic_variation == -3.1f);
+
+    // south and west are negative
+    teseo::nmea::gga fix;
+    assert(teseo::nmea::decode(teseo_format[0], fix));
+    assert(std::fabs(fix.latitude + (33.0 + 51.402 / 60.0)) < 1e-9 && std::fabs(fix.longitude + 70.5) < 1e-9);
+}
+
+// without fix, the GGA has no position, altitude and geoid separation, whatever the data holds
+void encode_no_fix() {
+    teseo::nmea::gga fix;
+    assert(teseo::nmea::decode(teseo_format[0], fix));
+    fix.quality = 0;
+    fix.satellites = 0;
+    fix.hdop = 99.0f;
+    std::array<char, teseo::nmea::max_sentence_length> buffer;
+    assert(std::string_view(buffer.data(), teseo::nmea::encode(fix, buffer)) == teseo_format[1]);
+}
+
+// a buffer that is too small gets 0, and nothing past its end
+void encode_buffer_too_small() {
+    teseo::nmea::rmc data;
+    assert(teseo::nmea::decode(teseo_format[2], data));
+    std::array<char, teseo::nmea::max_sentence_length + 1> buffer;
+    for (std::size_t size = 0; size < teseo_format[2].length(); size++) {
+        buffer.fill('#');
+        assert(teseo::nmea::encode(data, std::span(buffer).first(size)) == 0);
+        assert(buffer[size] == '#');
+    }
+    assert(teseo::nmea::encode(data, std::span(buffer).first(teseo_format[2].length())) == teseo_format[2].length());
+
+    // the longest fields fit max_sentence_length
+    data.latitude = -89.999999;
+    data.longitude = -179.999999;
+    data.speed_knots = 999.9f;
+    data.course = 359.9f;
+    data.magnetic_variation = -179.9f;
+    assert(teseo::nmea::encode(data, std::span(buffer).first(teseo::nmea::max_sentence_length)) != 0);
+}
+
+} // namespace
+
+int main() {
+    batch_mismatched_spans();
+    encode_round_trip();
+    encode_no_fix();
+    encode_buffer_too_small();
+    std::puts("nmea_test: passed");
+    return 0;
+}
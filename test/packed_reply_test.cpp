@@ -0,0 +1,130 @@
+// host test for teseo::packed_reply
+// g++ -std=c++20 -pthread -Icallbackmanager -Iteseo test/packed_reply_test.cpp teseo/teseo.cpp -o packed_reply_test && ./packed_reply_test
+
+#undef NDEBUG
+#include "teseo.h"
+#include <cassert>
+#include <array>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace {
+
+const std::string gsv = "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74\r\n";
+const std::string status = "$PSTMNMEAREQUEST,80000,0\r\n";
+const std::string gl_gsv = "$GLGSV,1,1,03,65,48,034,38,72,22,300,31,88,61,112,40*50\r\n";
+
+// a Teseo that replies with a fixed string
+struct link {
+    std::string reply;
+    teseo::teseo gps;
+
+    link() {
+        gps.writer().set([](const std::string&) -> void {});
+        gps.reader().set([this](std::string& s) -> void { s = reply; });
+    }
+};
+
+// a reply with more lines than the table holds is validated up to the status line
+void more_lines_than_table() {
+    std::string reply;
+    teseo::teseo gps;
+    gps.writer().set([](const std::string&) -> void {});
+    gps.reader().set([&reply](std::string& s) -> void { s = reply; });
+
+    for (std::size_t i = 0; i < teseo::packed_reply::max_lines + 8; i++) {
+        reply += gsv;
+    }
+    teseo::packed_reply packed;
+    assert(!gps.ask<teseo::sentence::gsv>(packed)); // no status line
+    assert(!packed.valid());
+    assert(packed.size() == 0);
+
+    reply += "$GPGS"; // corrupted last line, then the status line
+    reply += status;
+    assert(!gps.ask<teseo::sentence::gsv>(packed));
+
+    reply.erase(reply.length() - status.length() - 5);
+    reply += status;
+    assert(gps.ask<teseo::sentence::gsv>(packed));
+    assert(packed.valid());
+    assert(packed.size() == teseo::packed_reply::max_lines);
+    assert(packed[teseo::packed_reply::max_lines - 1] == gsv);
+    assert(packed.dropped() == 8); // valid, but incomplete
+}
+
+// the filter picks the lines for the table. Rejected lines are not dropped lines
+void filtered() {
+    link l;
+    for (std::size_t i = 0; i < teseo::packed_reply::max_lines; i++) {
+        l.reply += gsv + gl_gsv;
+    }
+    l.reply += status;
+    static constexpr std::array<std::string_view, 1> glonass {"GL"};
+    teseo::packed_reply packed;
+    assert(l.gps.ask<teseo::sentence::gsv>(packed, {.talkers = glonass}));
+    assert(packed.size() == teseo::packed_reply::max_lines);
+    assert(packed.dropped() == 0);
+    for (std::size_t i = 0; i < packed.size(); i++) {
+        assert(packed[i] == gl_gsv);
+    }
+    assert(packed.raw() == l.reply);
+
+    assert(l.gps.ask<teseo::sentence::gsv>(packed));
+    assert(packed.size() == teseo::packed_reply::max_lines);
+    assert(packed.dropped() == teseo::packed_reply::max_lines);
+}
+
+// a reply moves to another thread without copying its lines
+void moved_to_thread() {
+    link l;
+    l.reply = gsv + gl_gsv + status;
+    teseo::packed_reply packed;
+    assert(l.gps.ask<teseo::sentence::gsv>(packed));
+    const char* data = packed.raw().data();
+
+    std::size_t lines = 0;
+    bool same_buffer = false;
+    std::thread consumer([reply = std::move(packed), data, &lines, &same_buffer]() {
+        lines = reply.size();
+        same_buffer = reply.raw().data() == data && reply[0].data() == data;
+        assert(reply[0] == gsv && reply[1] == gl_gsv);
+    });
+    consumer.join();
+    assert(lines == 2);
+    assert(same_buffer);
+}
+
+// release() gives the buffer back, and the next reply reuses its capacity
+void released_buffer_reused() {
+    link l;
+    for (std::size_t i = 0; i < 8; i++) {
+        l.reply += gsv;
+    }
+    l.reply += status;
+    teseo::packed_reply first;
+    assert(l.gps.ask<teseo::sentence::gsv>(first));
+    std::string buffer = first.release();
+    assert(first.size() == 0 && first.dropped() == 0 && !first.valid());
+    const std::size_t capacity = buffer.capacity();
+    assert(capacity >= l.reply.length());
+
+    teseo::packed_reply next(std::move(buffer));
+    assert(next.raw().empty() && next.size() == 0);
+    l.reply = gsv + status; // shorter: fits without growing
+    assert(l.gps.ask<teseo::sentence::gsv>(next));
+    assert(next.size() == 1 && next[0] == gsv);
+    assert(next.release().capacity() == capacity);
+}
+
+} // namespace
+
+int main() {
+    more_lines_than_table();
+    filtered();
+    moved_to_thread();
+    released_buffer_reused();
+    std::puts("packed_reply_test: passed");
+    return 0;
+}
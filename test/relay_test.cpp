@@ -0,0 +1,87 @@
+// host test for teseo::relay
+// g++ -std=c++20 -Icallbackmanager -Iteseo -Irelay test/relay_test.cpp teseo/teseo.cpp -o relay_test && ./relay_test
+
+#undef NDEBUG
+#include "relay.h"
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <array>
+
+namespace {
+
+const std::string gga = "$GPGGA,120000.000,5051.00000,N,00426.00000,E,1,07,1.2,70.0,M,47.0,M,,*6E\r\n";
+const std::string gsv = "$GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74\r\n";
+constexpr std::array<std::string_view, 1> gga_only {"GGA"};
+
+// writer that keeps what it gets, up to limit bytes per call
+struct sink {
+    std::string data;
+    std::size_t limit = SIZE_MAX;
+
+    std::size_t write(std::span<const std::string_view> pieces) {
+        std::size_t written = 0;
+        for (auto piece : pieces) {
+            const std::size_t n = std::min(piece.size(), limit - written);
+            data.append(piece.substr(0, n));
+            written += n;
+        }
+        return written;
+    }
+};
+
+// an output that fell behind by more than Sentences counts only the sentences its filter accepts as dropped
+void dropped_counts_wanted_only() {
+    teseo::relay<4096, 8, 2> relay;
+    sink slow;
+    sink all;
+    relay.filter(0, {.sentences = gga_only});
+    relay.output(0).set([&slow](std::span<const std::string_view> pieces) -> std::size_t { return slow.write(pieces); });
+    relay.output(1).set([&all](std::span<const std::string_view> pieces) -> std::size_t { return all.write(pieces); });
+
+    for (int i = 0; i < 10; i++) {
+        relay.push(gga);
+        relay.push(gsv);
+    }
+    relay.pump(0);
+    // 20 stored, the last 8 (4 GGA) are still in the ring
+    assert(relay.statistics(0).dropped == 6);
+    assert(relay.statistics(0).sentences == 4);
+    assert(slow.data.size() == 4 * gga.size());
+}
+
+// a sentence that is lost while partly written is ended, and the next one starts on its own line
+void cut_sentence_ended() {
+    teseo::relay<256, 16, 1> relay;
+    sink out;
+    out.limit = 10;
+    relay.output(0).set([&out](std::span<const std::string_view> pieces) -> std::size_t { return out.write(pieces); });
+
+    relay.push(gga);
+    relay.pump(0);
+    assert(out.data == gga.substr(0, 10));
+    for (int i = 0; i < 4; i++) { // overwrites the partly written GGA
+        relay.push(gsv);
+    }
+    out.limit = 1; // the "\r\n" can be split over writes too
+    relay.pump(0);
+    out.limit = SIZE_MAX;
+    while (!relay.pump(0)) {}
+
+    assert(out.data.starts_with(gga.substr(0, 10) + "\r\n$"));
+    assert(relay.statistics(0).dropped >= 1);
+    // every line starts with '$'
+    for (std::size_t start = 0; start < out.data.size(); start = out.data.find("\r\n", start) + 2) {
+        assert(out.data[start] == '$');
+    }
+    assert(out.data.ends_with("\r\n"));
+}
+
+} // namespace
+
+int main() {
+    dropped_counts_wanted_only();
+    cut_sentence_ended();
+    std::puts("relay_test: passed");
+    return 0;
+}
@@ -0,0 +1,97 @@
+// host test for teseo::resync(), over the simulator
+// g++ -std=c++20 -Icallbackmanager -Iteseo -Isimulator test/resync_test.cpp teseo/teseo.cpp -o resync_test && ./resync_test
+
+#undef NDEBUG
+#include "teseo.h"
+#include "simulator.h"
+#include <cassert>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+// simulator link that counts restarts, resets and reads
+struct link {
+    teseo::simulator sim;
+    unsigned int restarts = 0;
+    unsigned int resets = 0;
+    unsigned int reads = 0;
+    //! replies are garbage until the Teseo is configured again
+    bool configured = true;
+
+    void attach(teseo::teseo& gps, bool resetter) {
+        gps.writer().set([this](const std::string& s) -> void {
+            if (s.starts_with("$PSTMGPSRESTART")) {
+                restarts++;
+                configured = true;
+            }
+            sim.write(s);
+        });
+        gps.reader().set([this](std::string& s) -> void {
+            reads++;
+            sim.read(s);
+            if (!configured && s.starts_with("$GP")) {
+                s[3] = '\xff';
+            }
+        });
+        if (resetter) {
+            gps.resetter().set([this]() -> void { resets++; sim.reset(); });
+        }
+    }
+};
+
+// a link that works needs only the drain and the probe
+void healthy_link() {
+    link l;
+    teseo::teseo gps;
+    l.attach(gps, true);
+    assert(gps.resync());
+    assert(l.restarts == 0);
+    assert(l.resets == 0);
+}
+
+// a lost configuration is restored with a restart, without reset
+void lost_configuration() {
+    link l;
+    teseo::teseo gps;
+    l.attach(gps, true);
+    l.configured = false;
+    assert(gps.resync());
+    assert(l.restarts == 1);
+    assert(l.resets == 0);
+}
+
+// a link that streams without end: resync() gives up, within a bounded number of reads
+void endless_stream() {
+    unsigned int reads = 0;
+    teseo::teseo gps;
+    gps.writer().set([](const std::string&) -> void {});
+    gps.reader().set([&reads](std::string& s) -> void {
+        reads++;
+        s = "$GPZDA,123519.000,23,03,1994,00,00*5C\r\n";
+    });
+    assert(!gps.resync());
+    assert(reads < 32);
+}
+
+// a link that returns only garbage: the reset is tried, once
+void garbage_only() {
+    link l;
+    teseo::teseo gps;
+    l.attach(gps, true);
+    l.sim.faults().ff_flood = 1.0;
+    assert(!gps.resync());
+    assert(l.resets == 1);
+    assert(l.reads < 64);
+}
+
+} // namespace
+
+int main() {
+    healthy_link();
+    lost_configuration();
+    endless_stream();
+    garbage_only();
+    std::puts("resync_test: passed");
+    return 0;
+}
@@ -0,0 +1,138 @@
+// host test for teseo::trace
+// g++ -std=c++20 -pthread -DTESEO_TRACE -DTESEO_TRACE_CAPACITY=64 -Icallbackmanager -Itrace test/trace_test.cpp trace/trace.cpp -o trace_test && ./trace_test
+
+#undef NDEBUG
+#include "trace.h"
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// the dump, as a string
+std::string dump() {
+    std::FILE* file = std::tmpfile();
+    assert(file != nullptr);
+    teseo::tracer().dump(file);
+    std::string json;
+    std::rewind(file);
+    char buffer[256];
+    while (std::size_t n = std::fread(buffer, 1, sizeof(buffer), file)) {
+        json.append(buffer, n);
+    }
+    std::fclose(file);
+    return json;
+}
+
+// the events of a dump: name, phase, time and thread, one per line
+struct parsed {
+    std::string name;
+    char phase;
+    unsigned long long time_us;
+    unsigned long thread;
+};
+
+std::vector<parsed> events(const std::string& json) {
+    std::vector<parsed> out;
+    std::size_t start = json.find('\n') + 1; // after {"traceEvents":[
+    while (start < json.size() && json[start] == '{') {
+        char name[32];
+        parsed e;
+        int fields = std::sscanf(json.c_str() + start, "{\"name\":\"%31[^\"]\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":0,\"tid\":%lu",
+            name, &e.phase, &e.time_us, &e.thread);
+        assert(fields == 4);
+        e.name = name;
+        out.push_back(e);
+        start = json.find('\n', start) + 1;
+    }
+    return out;
+}
+
+// Chrome trace JSON: begin, end and instant events, with the clock and thread handlers
+void chrome_json() {
+    uint64_t now = 100;
+    teseo::tracer().clear();
+    teseo::tracer().clock().set([&now]() -> uint64_t { return now++; });
+    teseo::tracer().thread().set([]() -> uint32_t { return 7; });
+    {
+        TESEO_TRACE_SCOPE("poll");
+        TESEO_TRACE_INSTANT("resync: reset");
+    }
+    assert(dump() == "{\"traceEvents\":[\n"
+        "{\"name\":\"poll\",\"ph\":\"B\",\"ts\":100,\"pid\":0,\"tid\":7},\n"
+        "{\"name\":\"resync: reset\",\"ph\":\"i\",\"ts\":101,\"pid\":0,\"tid\":7,\"s\":\"t\"},\n"
+        "{\"name\":\"poll\",\"ph\":\"E\",\"ts\":102,\"pid\":0,\"tid\":7}\n"
+        "]}\n");
+
+    teseo::tracer().clear();
+    assert(dump() == "{\"traceEvents\":[\n\n]}\n");
+}
+
+// when the ring wraps, the oldest events are dropped, and the rest stay in order
+void ring_wrap() {
+    static std::array<std::string, 100> names;
+    uint64_t now = 0;
+    teseo::tracer().clear();
+    teseo::tracer().clock().set([&now]() -> uint64_t { return now++; });
+    for (std::size_t i = 0; i < names.size(); i++) {
+        names[i] = "e" + std::to_string(i);
+        teseo::tracer().instant(names[i].c_str());
+    }
+    std::vector<parsed> recorded = events(dump());
+    assert(recorded.size() == teseo::trace::capacity);
+    for (std::size_t i = 0; i < recorded.size(); i++) {
+        const std::size_t index = names.size() - teseo::trace::capacity + i;
+        assert(recorded[i].name == names[index]);
+        assert(recorded[i].time_us == index);
+    }
+}
+
+// dumps while writers wrap the ring: every dumped event is whole, its name matches its thread
+void dump_while_wrapping() {
+    static constexpr std::array<const char*, 4> names {"w0", "w1", "w2", "w3"};
+    static thread_local uint32_t id = 0;
+    teseo::tracer().clear();
+    teseo::tracer().clock().set([]() -> uint64_t { return id * 1000000ull; });
+    teseo::tracer().thread().set([]() -> uint32_t { return id; });
+    std::atomic<bool> stop {false};
+    std::vector<std::thread> writers;
+    for (uint32_t t = 0; t < names.size(); t++) {
+        writers.emplace_back([&stop, t]() {
+            id = t;
+            while (!stop.load(std::memory_order_relaxed)) {
+                teseo::tracer().instant(names[t]);
+                teseo::tracer().begin(names[t]);
+                teseo::tracer().end(names[t]);
+            }
+        });
+    }
+    std::size_t checked = 0;
+    for (int i = 0; i < 200; i++) {
+        for (const parsed& e : events(dump())) {
+            assert(e.thread < names.size());
+            assert(e.name == names[e.thread]);
+            assert(e.time_us == e.thread * 1000000ull);
+            assert(e.phase == 'i' || e.phase == 'B' || e.phase == 'E');
+            checked++;
+        }
+    }
+    stop.store(true);
+    for (auto& w : writers) {
+        w.join();
+    }
+    assert(checked > 0);
+}
+
+} // namespace
+
+int main() {
+    chrome_json();
+    ring_wrap();
+    dump_while_wrapping();
+    std::puts("trace_test: passed");
+    return 0;
+}
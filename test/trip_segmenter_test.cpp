@@ -0,0 +1,112 @@
+// host test for teseo::trip_segmenter
+// g++ -std=c++20 -Icallbackmanager -Inmea -Igeodesy -Itrip test/trip_segmenter_test.cpp trip/trip_segmenter.cpp geodesy/distance.cpp nmea/nmea.cpp -o trip_segmenter_test && ./trip_segmenter_test
+
+#undef NDEBUG
+#include "trip_segmenter.h"
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr double latitude = 50.85;
+// degrees per m, along the parallel and the meridian
+const double east_per_m = 1.0 / (111320.0 * std::cos(latitude * 3.14159265358979323846 / 180.0));
+constexpr double north_per_m = 1.0 / 110574.0;
+
+// a vehicle on a road along the parallel, with a fix per second
+struct drive {
+    teseo::trip_segmenter trips;
+    std::vector<teseo::trip_event> events;
+    uint64_t time_ms = 0;
+    double east_m = 0.0;
+    double north_m = 0.0;
+
+    drive() {
+        trips.event().set([this](const teseo::trip_event& e) -> void { events.push_back(e); });
+    }
+
+    void run(unsigned int seconds, float speed_mps, float drift_north_mps = 0.0f, uint8_t quality = 1) {
+        for (unsigned int i = 0; i < seconds; i++) {
+            time_ms += 1000;
+            east_m += speed_mps;
+            north_m += drift_north_mps;
+            trips.add(time_ms, latitude + north_m * north_per_m, 4.35 + east_m * east_per_m, speed_mps, quality);
+        }
+    }
+};
+
+// park, drive 2 minutes, stop 90 s, drive 1 minute, park
+void start_stop_end() {
+    drive d;
+    d.run(10, 0.0f);
+    d.run(120, 10.0f);
+    d.run(90, 0.0f);
+    d.run(60, 10.0f);
+    d.run(400, 0.0f);
+
+    assert(d.events.size() == 3);
+    assert(d.events[0].type == teseo::trip_event::kind::trip_start);
+    assert(d.events[0].time_ms == 11000); // the first fix at speed
+    assert(d.events[1].type == teseo::trip_event::kind::stop);
+    assert(d.events[1].duration_ms >= 89000 && d.events[1].duration_ms <= 91000);
+    const teseo::trip_event& end = d.events[2];
+    assert(end.type == teseo::trip_event::kind::trip_end);
+    assert(end.stops == 1);
+    assert(std::fabs(end.distance_m - 1800.0) < 20.0);
+    assert(std::fabs(end.mean_speed_mps - 10.0f) < 0.5f);
+    assert(end.max_speed_mps == 10.0f);
+    assert(!d.trips.moving());
+}
+
+// a parked receiver, whose position drifts with speed 0, makes no trip
+void parked_drift() {
+    drive d;
+    d.run(3600, 0.0f, 0.02f);
+    assert(d.events.empty());
+    assert(!d.trips.moving());
+}
+
+// a position jump at walking speed, that stops at once, is no trip
+void short_hop_dropped() {
+    drive d;
+    d.run(10, 0.0f);
+    d.east_m += 80.0;
+    d.run(2, 1.5f);
+    d.run(400, 0.0f);
+    assert(d.events.empty());
+    assert(!d.trips.moving());
+}
+
+// without fixes, the trip ends at the last one. With tick(), or with fixes without quality
+void fixes_stop() {
+    drive d;
+    d.run(60, 10.0f);
+    assert(d.events.size() == 1);
+    const uint64_t last_fix = d.time_ms;
+    d.trips.tick(last_fix + 299000);
+    assert(d.trips.moving());
+    d.trips.tick(last_fix + 300000);
+    assert(!d.trips.moving());
+    assert(d.events.size() == 2);
+    assert(d.events[1].type == teseo::trip_event::kind::trip_end);
+    assert(d.events[1].time_ms == last_fix);
+
+    drive underground;
+    underground.run(60, 10.0f);
+    underground.run(300, 0.0f, 0.0f, 0);
+    assert(underground.events.size() == 2);
+    assert(underground.events[1].type == teseo::trip_event::kind::trip_end);
+}
+
+} // namespace
+
+int main() {
+    start_stop_end();
+    parked_drift();
+    short_hop_dropped();
+    fixes_stop();
+    std::puts("trip_segmenter_test: passed");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "trace.h"
+
+namespace teseo {
+
+trace& tracer() {
+    static trace recorder;
+    return recorder;
+}
+
+void trace::record(const char* name, char phase) {
+    uint64_t index = head_.fetch_add(1, std::memory_order_relaxed);
+    event& e = events_[index % capacity];
+    // claim, so that dump() skips the slot while it changes, and no writer that laps this one writes it too
+    uint64_t sequence = e.sequence.load(std::memory_order_relaxed);
+    do {
+        if (sequence == busy) {
+            return; // a writer a full ring behind still has it: the ring is too small, drop this event
+        }
+    } while (!e.sequence.compare_exchange_weak(sequence, busy, std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_release);
+    e.time_us.store(clock_.call(), std::memory_order_relaxed);
+    e.name.store(name, std::memory_order_relaxed);
+    e.thread.store(thread_.call(), std::memory_order_relaxed);
+    e.phase.store(phase, std::memory_order_relaxed);
+    e.sequence.store(index + 1, std::memory_order_release);
+}
+
+void trace::clear() {
+    for (auto& e : events_) {
+        e.sequence.store(0, std::memory_order_relaxed);
+    }
+    head_.store(0, std::memory_order_release);
+}
+
+void trace::dump(std::FILE* file) const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t first = head > capacity ? head - capacity : 0;
+    bool comma = false;
+    std::fputs("{\"traceEvents\":[\n", file);
+    for (uint64_t index = first; index < head; index++) {
+        const event& e = events_[index % capacity];
+        if (e.sequence.load(std::memory_order_acquire) != index + 1) {
+            continue; // overwritten or incomplete
+        }
+        // copy, then check that no writer claimed the slot meanwhile
+        const uint64_t time_us = e.time_us.load(std::memory_order_relaxed);
+        const char* name = e.name.load(std::memory_order_relaxed);
+        const uint32_t thread = e.thread.load(std::memory_order_relaxed);
+        const char phase = e.phase.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.sequence.load(std::memory_order_relaxed) != index + 1) {
+            continue; // overwritten while copied
+        }
+        std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":0,\"tid\":%lu%s}",
+            comma ? ",\n" : "", name, phase, static_cast<unsigned long long>(time_us),
+            static_cast<unsigned long>(thread), phase == 'i' ? ",\"s\":\"t\"" : "");
+        comma = true;
+    }
+    std::fputs("\n]}\n", file);
+}
+
+bool trace::dump(const char* path) const {
+    std::FILE* file = std::fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    dump(file);
+    return std::fclose(file) == 0;
+}
+
+} // namespace teseo
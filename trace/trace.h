@@ -0,0 +1,137 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include "callbackmanager.h"
+
+// Sources include this header only when TESEO_TRACE is defined. Without it, a build doesn't need trace/.
+
+#ifndef TESEO_TRACE_CAPACITY
+#define TESEO_TRACE_CAPACITY 1024
+#endif
+
+namespace teseo {
+
+//! Trace recorder for driver activity. Optional: only active when the library is built with TESEO_TRACE defined.
+/*!
+  Records begin, end and instant events in a fixed size ring buffer. Recording is lock-free: one atomic increment
+  to claim a slot. When the ring is full, the oldest events are overwritten.  
+  dump() writes the events in Chrome trace JSON. Open the file in chrome://tracing or https://ui.perfetto.dev  
+
+  The developer registers a clock (µs) and, for multi threaded use, a thread id handler.
+
+  Example code:
+  @code
+  teseo::tracer().clock().set([]() -> uint64_t { return time_us_64(); });
+  // ... run
+  teseo::tracer().dump("teseo_trace.json");
+  @endcode
+*/
+class trace {
+public:
+
+    //! ring buffer size, in events. Override with TESEO_TRACE_CAPACITY
+    static constexpr std::size_t capacity = TESEO_TRACE_CAPACITY;
+
+    trace() : events_(), head_(0) {}
+
+    //! expose the callback manager for the clock. Returns µs. Without clock, all events get time 0.
+    inline Callback<uint64_t>& clock() {
+        return clock_;
+    }
+
+    //! expose the callback manager for the thread id. Without handler, all events are on thread 0.
+    inline Callback<uint32_t>& thread() {
+        return thread_;
+    }
+
+    //! record the begin of an activity
+    /*!
+      \param name const char pointer. Has to be a string literal, or live until dump().
+    */
+    inline void begin(const char* name) {
+        record(name, 'B');
+    }
+
+    //! record the end of an activity. See begin()
+    inline void end(const char* name) {
+        record(name, 'E');
+    }
+
+    //! record a decision or event without duration. See begin()
+    inline void instant(const char* name) {
+        record(name, 'i');
+    }
+
+    //! discard all events
+    void clear();
+
+    //! write the recorded events in Chrome trace JSON format
+    /*!
+      \param file std::FILE pointer, open for writing.  
+      Can be called while other threads record. Events that are being written or overwritten during the dump are
+      skipped, not torn. When a writer laps another one on the same slot, its event is dropped.
+    */
+    void dump(std::FILE* file) const;
+
+    //! write the recorded events in Chrome trace JSON format to a file
+    /*!
+      \param path const char pointer file name.  
+      \returns bool true if the file was written
+    */
+    bool dump(const char* path) const;
+
+private:
+
+    //! the fields are atomic, so that dump() can read a slot that a writer changes. Relaxed: sequence orders them
+    struct event {
+        //! head_ value + 1 of the record that owns this slot. 0: empty, busy: being written
+        std::atomic<uint64_t> sequence;
+        std::atomic<uint64_t> time_us;
+        std::atomic<const char*> name;
+        std::atomic<uint32_t> thread;
+        std::atomic<char> phase;
+    };
+
+    static constexpr uint64_t busy = UINT64_MAX;
+
+    void record(const char* name, char phase);
+
+    std::array<event, capacity> events_;
+    std::atomic<uint64_t> head_;
+    Callback<uint64_t> clock_;
+    Callback<uint32_t> thread_;
+};
+
+//! the trace recorder that the library writes to
+trace& tracer();
+
+//! records begin at construction, end at destruction
+class trace_scope {
+public:
+    trace_scope(const char* name) : name_(name) {
+        tracer().begin(name_);
+    }
+    ~trace_scope() {
+        tracer().end(name_);
+    }
+private:
+    const char* name_;
+};
+
+} // namespace teseo
+
+#ifdef TESEO_TRACE
+#define TESEO_TRACE_CONCAT_(a, b) a##b
+#define TESEO_TRACE_CONCAT(a, b) TESEO_TRACE_CONCAT_(a, b)
+#define TESEO_TRACE_SCOPE(name) ::teseo::trace_scope TESEO_TRACE_CONCAT(teseo_trace_scope_, __LINE__)(name)
+#define TESEO_TRACE_INSTANT(name) ::teseo::tracer().instant(name)
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+
+#endif // TRACE_H_
@@ -0,0 +1,147 @@
+#include "trip_segmenter.h"
+#ifdef TESEO_TRACE
+#include "trace.h"
+#else
+#define TESEO_TRACE_SCOPE(name)
+#define TESEO_TRACE_INSTANT(name)
+#endif
+#include <algorithm>
+
+namespace teseo {
+
+void trip_segmenter::add(uint64_t time_ms, double latitude, double longitude, float speed_mps, uint8_t quality) {
+    if (!quality) {
+        tick(time_ms);
+        return;
+    }
+    last_fix_ms_ = time_ms;
+    last_latitude_ = latitude;
+    last_longitude_ = longitude;
+    if (!anchored_) {
+        anchor(time_ms, latitude, longitude);
+    }
+    if (speed_mps < limits_.move_speed_mps) {
+        fast_ = false;
+    } else if (!fast_) {
+        fast_ = true;
+        fast_since_ = time_ms;
+    }
+
+    switch (state_) {
+    case state::idle:
+        if (speed_mps < limits_.stop_speed_mps) {
+            anchor(time_ms, latitude, longitude); // standing still. The window follows the drift
+            break;
+        }
+        if (fast_ && time_ms - fast_since_ >= limits_.move_confirm_ms) {
+            start_trip(fast_since_, anchor_latitude_, anchor_longitude_);
+            confirm();
+        } else if (from_anchor(latitude, longitude) > limits_.radius_m) {
+            start_trip(fast_ ? fast_since_ : time_ms, anchor_latitude_, anchor_longitude_);
+        } else {
+            break;
+        }
+        odometer_.add(latitude, longitude);
+        trip_.max_speed_mps = speed_mps;
+        break;
+    case state::moving:
+        odometer_.add(latitude, longitude);
+        trip_.max_speed_mps = std::max(trip_.max_speed_mps, speed_mps);
+        if (!trip_.confirmed && time_ms - trip_.start_ms >= limits_.move_confirm_ms) {
+            confirm();
+        }
+        if (speed_mps < limits_.stop_speed_mps) {
+            state_ = state::stopping;
+            anchor(time_ms, latitude, longitude);
+        }
+        break;
+    case state::stopping:
+        if (speed_mps >= limits_.move_speed_mps || from_anchor(latitude, longitude) > limits_.radius_m) {
+            const uint32_t dwell = static_cast<uint32_t>(time_ms - since_);
+            if (dwell >= limits_.stop_confirm_ms) {
+                if (!trip_.confirmed) { // what came before the stop was no trip. Start over from here
+                    start_trip(time_ms, anchor_latitude_, anchor_longitude_);
+                    odometer_.add(latitude, longitude);
+                    trip_.max_speed_mps = speed_mps;
+                    break;
+                }
+                TESEO_TRACE_INSTANT("trip: stop");
+                trip_.stops++;
+                trip_.dwell_ms += dwell;
+                event_.call(trip_event{.type = trip_event::kind::stop, .time_ms = since_,
+                    .latitude = anchor_latitude_, .longitude = anchor_longitude_, .duration_ms = dwell,
+                    .dwell_ms = 0, .distance_m = 0.0, .max_speed_mps = 0.0f, .mean_speed_mps = 0.0f, .stops = 0});
+            }
+            state_ = state::moving;
+            odometer_.add(latitude, longitude);
+            trip_.max_speed_mps = std::max(trip_.max_speed_mps, speed_mps);
+        } else {
+            tick(time_ms);
+        }
+        break;
+    }
+}
+
+void trip_segmenter::tick(uint64_t time_ms) {
+    if (state_ == state::stopping && time_ms - since_ >= limits_.trip_end_ms) {
+        end_trip();
+    } else if (state_ == state::moving && time_ms - last_fix_ms_ >= limits_.trip_end_ms) {
+        anchor(last_fix_ms_, last_latitude_, last_longitude_); // no fixes: the trip ended at the last one
+        end_trip();
+    }
+}
+
+void trip_segmenter::add(uint64_t time_ms, const nmea::gga& fix, const nmea::rmc& motion) {
+    add(time_ms, fix.latitude, fix.longitude, motion.speed_knots * 0.514444f, fix.quality);
+}
+
+void trip_segmenter::add(uint64_t time_ms, const nmea::gga& fix, const nmea::vtg& motion) {
+    add(time_ms, fix.latitude, fix.longitude, motion.speed_kmh / 3.6f, fix.quality);
+}
+
+void trip_segmenter::anchor(uint64_t time_ms, double latitude, double longitude) {
+    anchor_latitude_ = latitude;
+    anchor_longitude_ = longitude;
+    anchored_ = true;
+    since_ = time_ms;
+}
+
+double trip_segmenter::from_anchor(double latitude, double longitude) const {
+    return geodesy::haversine(anchor_latitude_, anchor_longitude_, latitude, longitude);
+}
+
+void trip_segmenter::start_trip(uint64_t time_ms, double latitude, double longitude) {
+    state_ = state::moving;
+    trip_ = summary();
+    trip_.start_ms = time_ms;
+    trip_.start_latitude = latitude;
+    trip_.start_longitude = longitude;
+    odometer_.reset();
+    odometer_.add(latitude, longitude);
+}
+
+void trip_segmenter::confirm() {
+    TESEO_TRACE_INSTANT("trip: start");
+    trip_.confirmed = true;
+    event_.call(trip_event{.type = trip_event::kind::trip_start, .time_ms = trip_.start_ms,
+        .latitude = trip_.start_latitude, .longitude = trip_.start_longitude, .duration_ms = 0,
+        .dwell_ms = 0, .distance_m = 0.0, .max_speed_mps = 0.0f, .mean_speed_mps = 0.0f, .stops = 0});
+}
+
+void trip_segmenter::end_trip() {
+    state_ = state::idle;
+    fast_ = false;
+    if (!trip_.confirmed) {
+        return; // it never moved for move_confirm_ms: no trip
+    }
+    TESEO_TRACE_INSTANT("trip: end");
+    const uint32_t duration = static_cast<uint32_t>(since_ - trip_.start_ms);
+    const uint32_t moving_ms = duration - std::min(duration, trip_.dwell_ms);
+    const double distance = odometer_.total();
+    event_.call(trip_event{.type = trip_event::kind::trip_end, .time_ms = since_,
+        .latitude = anchor_latitude_, .longitude = anchor_longitude_, .duration_ms = duration,
+        .dwell_ms = trip_.dwell_ms, .distance_m = distance, .max_speed_mps = trip_.max_speed_mps,
+        .mean_speed_mps = moving_ms ? static_cast<float>(distance * 1000.0 / moving_ms) : 0.0f, .stops = trip_.stops});
+}
+
+} // namespace teseo
@@ -0,0 +1,187 @@
+#ifndef TRIP_SEGMENTER_H_
+#define TRIP_SEGMENTER_H_
+
+#include <cstdint>
+#include "callbackmanager.h"
+#include "nmea.h"
+#include "distance.h"
+
+namespace teseo {
+
+//! trip_segmenter thresholds
+struct trip_limits {
+    //! at or above this speed, the vehicle moves
+    float move_speed_mps = 2.0f;
+    //! below this speed, the vehicle may be stopping
+    float stop_speed_mps = 1.0f;
+    //! radius of the position dispersion window. Leaving it is movement, staying in it is standing still
+    float radius_m = 50.0f;
+    //! time at or above move_speed_mps that starts a trip
+    uint32_t move_confirm_ms = 5000;
+    //! standing still for this long is a stop. Shorter is traffic
+    uint32_t stop_confirm_ms = 60000;
+    //! standing still for this long ends the trip
+    uint32_t trip_end_ms = 300000;
+};
+
+//! trip_segmenter event
+struct trip_event {
+    enum class kind {
+        //! the trip is confirmed: it moved for move_confirm_ms. time_ms and position: where it left
+        trip_start,
+        //! a stop within a trip ended. time_ms and position: where it stood. duration_ms: the dwell time
+        stop,
+        //! the trip ended. time_ms and position: where it stopped. The other fields summarise the trip
+        trip_end
+    };
+    kind type;
+    //! time, as passed to add()
+    uint64_t time_ms;
+    double latitude;
+    double longitude;
+    //! stop: dwell time. trip_end: trip start to the final stop
+    uint32_t duration_ms;
+    //! trip_end: total dwell time of the stops
+    uint32_t dwell_ms;
+    //! trip_end: distance driven, m
+    double distance_m;
+    //! trip_end: highest speed
+    float max_speed_mps;
+    //! trip_end: distance over the time without stops
+    float mean_speed_mps;
+    //! trip_end: number of stops
+    unsigned int stops;
+};
+
+//! Online trip, stop and dwell detection.
+/*!
+  Add each decoded fix, with the speed of the same epoch from RMC or VTG. Events are reported through the event()
+  callback as soon as they are known, so that a device can upload trip summaries instead of raw tracks.
+  Constant memory: the state is a dispersion window anchor, the current trip's running statistics and an odometer.
+
+  - while the speed is below stop_speed_mps, the dispersion window follows the position, so that the drift of a
+    parked receiver doesn't add up to a trip
+  - a trip starts when the vehicle leaves the dispersion window at stop_speed_mps or more,
+    or keeps moving at move_speed_mps for move_confirm_ms
+  - the trip_start event comes when the trip has moved for move_confirm_ms. A trip that stops before is dropped,
+    without events
+  - during a trip, when the speed drops below stop_speed_mps a stop candidate starts. It is a stop when the vehicle
+    stays within radius_m for stop_confirm_ms. The stop event comes when the vehicle moves again, with the dwell time
+  - a stop that lasts trip_end_ms ends the trip. So does a trip_end_ms gap in the fixes (e.g.: underground),
+    at the last fix
+
+  Fixes without quality only advance the time. When no fixes arrive at all, call tick(). Call add() and tick()
+  from one thread.
+
+  Example code:
+  @code
+  teseo::trip_segmenter trips;
+  trips.event().set([](const teseo::trip_event& e) -> void { upload(e); });
+  // per epoch
+  trips.add(now_ms, gga, rmc);
+  @endcode
+*/
+class trip_segmenter {
+public:
+
+    //! constructor.
+    /*!
+      \param thresholds trip_limits.
+    */
+    trip_segmenter(const trip_limits& thresholds = trip_limits()) : limits_(thresholds), state_(state::idle),
+        anchor_latitude_(0.0), anchor_longitude_(0.0), anchored_(false), since_(0), fast_since_(0), fast_(false),
+        last_fix_ms_(0), last_latitude_(0.0), last_longitude_(0.0), trip_() {}
+
+    //! expose the callback manager for the events
+    /*!
+      Callback parameter: const trip_event reference. Only valid during the call.
+      For instructions on how to register your handler, check the documentation of teseo::writer().
+    */
+    inline Callback<void, const trip_event&>& event() {
+        return event_;
+    }
+
+    //! add a fix
+    /*!
+      \param time_ms uint64_t time of the fix, monotonic. E.g.: the host time, or UTC.
+      \param latitude double degrees.
+      \param longitude double degrees.
+      \param speed_mps float ground speed, m/s.
+      \param quality uint8_t fix quality. 0: only the time is used, see tick().
+    */
+    void add(uint64_t time_ms, double latitude, double longitude, float speed_mps, uint8_t quality);
+
+    //! add a GGA fix, with the speed from the RMC of the same epoch
+    void add(uint64_t time_ms, const nmea::gga& fix, const nmea::rmc& motion);
+
+    //! add a GGA fix, with the speed from the VTG of the same epoch
+    void add(uint64_t time_ms, const nmea::gga& fix, const nmea::vtg& motion);
+
+    //! advance the time without a fix, e.g.: from a timer while the receiver has no fix
+    /*!
+      \param time_ms uint64_t the current time, on the same clock as add().
+
+      Ends the trip after trip_end_ms standing still, or trip_end_ms without fixes.
+    */
+    void tick(uint64_t time_ms);
+
+    //! true during a trip
+    inline bool moving() const {
+        return state_ != state::idle;
+    }
+
+private:
+
+    enum class state {
+        //! no trip
+        idle,
+        //! trip, moving
+        moving,
+        //! trip, slow within the dispersion window. Maybe a stop
+        stopping
+    };
+
+    //! running statistics of the current trip
+    struct summary {
+        uint64_t start_ms = 0;
+        double start_latitude = 0.0;
+        double start_longitude = 0.0;
+        uint32_t dwell_ms = 0;
+        float max_speed_mps = 0.0f;
+        unsigned int stops = 0;
+        //! moved for move_confirm_ms: trip_start is reported
+        bool confirmed = false;
+    };
+
+    //! start the dispersion window at this position
+    void anchor(uint64_t time_ms, double latitude, double longitude);
+
+    //! distance from the dispersion window anchor, m
+    double from_anchor(double latitude, double longitude) const;
+
+    //! start a trip candidate. The trip_start event waits for confirm()
+    void start_trip(uint64_t time_ms, double latitude, double longitude);
+    void confirm();
+    void end_trip();
+
+    trip_limits limits_;
+    state state_;
+    double anchor_latitude_;
+    double anchor_longitude_;
+    bool anchored_;
+    //! when the vehicle arrived in the dispersion window
+    uint64_t since_;
+    //! start of the current run at or above move_speed_mps
+    uint64_t fast_since_;
+    bool fast_;
+    uint64_t last_fix_ms_;
+    double last_latitude_;
+    double last_longitude_;
+    summary trip_;
+    geodesy::odometer odometer_;
+    Callback<void, const trip_event&> event_;
+};
+
+} // namespace teseo
+
+#endif // TRIP_SEGMENTER_H_